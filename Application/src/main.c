@@ -2,6 +2,11 @@
 #include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#ifdef BSP_HAL_SIM
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/time.h>
+#endif
 
 #include "delay.h"
 #include "u1.h"
@@ -11,6 +16,9 @@
 #include "s2.h"
 #include "s5.h"
 #include "s7.h"
+#ifdef BSP_HAL_SIM
+#include "i2c_hal.h"
+#endif
 
 // ================== 全局宏定义 ==================
 #define LOOP_DELAY_MS 100
@@ -18,6 +26,9 @@
 #define FAN_SPEED_MEDIUM 40
 #define FAN_SPEED_HIGH 60
 #define TAP_THRESHOLD_G 10
+#define LOW_LIGHT_WARNING_SEC 6 // 低光照警告的显示时长 (单位: 秒)
+#define TUBE_BRIGHT_PAUSE 3 // 暂停时数码管的亮度等级 (0~15)
+#define I2C_TRACE_DUMP_SEC 60 // I2C传输统计和主循环耗时统计通过串口输出的间隔 (单位: 秒)
 // #define LOW_LIGHT_THRESHOLD 150 // 定义光照阈值 (单位: Lux)
 
 // --- NFC卡片唯一ID (UID) ---
@@ -64,7 +75,7 @@ typedef enum
     STATE_NFC_READ,            // 读取NFC卡片
     STATE_NFC_DISPLAY_PART1,   // 用于显示NFC ID的前半部分
     STATE_NFC_DISPLAY_PART2,   // 用于显示NFC ID的后半部分
-    STATE_LOW_LIGHT_WARNING,   // 用于低光照闪烁警告
+    STATE_LOW_LIGHT_WARNING,   // 低光照警告，数码管硬件闪烁
     STATE_BIND_MENU_PROMPT,    // 提示用户选择要绑定的卡类型 (1: Study, 2: Deep, 3: Data)
     STATE_BINDING_STUDY,       // 等待绑定“学习卡”
     STATE_BINDING_DEEP_WORK,   // 等待绑定“深度工作卡”
@@ -87,7 +98,6 @@ volatile SystemState currentState = STATE_IDLE;
 volatile int remaining_seconds = 0;
 volatile bool g_second_has_passed = false;
 volatile int ui_timer_seconds = 0;   // 新增的UI计时器
-volatile int flash_count = 0;        // 用于控制闪烁次数
 volatile int tap_cooldown_ticks = 0; // 用于敲击检测的冷却计时器
 volatile SystemState previousState = STATE_IDLE;
 
@@ -103,9 +113,11 @@ int fan_level = 1;
 char last_key_pressed = 0;
 unsigned char last_read_card_id[4] = {0};
 volatile unsigned int low_light_threshold = 150; // 定义光照阈值 (单位: Lux)
+volatile unsigned int boot_time_us = 0;          // 硬件初始化耗时 (单位: 微秒)，总线扫描的明细见i2c_scan_stat
 
 // ================== 函数声明 ==================
 void hardware_init(void);
+void hardware_reprobe(void);
 void handle_inputs(void);
 void update_state_machine(void);
 void perform_continuous_checks(void);
@@ -113,6 +125,7 @@ void load_task_mode(const unsigned char *card_uid);
 void start_focus_mode(void);
 void start_rest_mode(void);
 void update_display(void);
+void update_display_mode(void);
 void handle_keypad_input(char key);
 void start_scrolling(const char *text);
 void stop_scrolling();
@@ -120,6 +133,40 @@ bool apply_setting(void);
 void enter_setting_edit_mode(SettingType type, int initial_value);
 
 // ================== 重写的硬件定时器代码 ==================
+// 每秒一次：递减计时器并通知主循环
+static void hz_timer_tick(void)
+{
+    // 1. 递减主计时器
+    if (remaining_seconds > 0)
+    {
+        remaining_seconds--;
+    }
+
+    // 新增：管理UI计时器
+    if (ui_timer_seconds > 0)
+    {
+        ui_timer_seconds--;
+    }
+
+    // 2. 设置标志位，通知主循环“一秒钟过去了”
+    g_second_has_passed = true;
+}
+
+#ifdef BSP_HAL_SIM
+// PC上没有Timer0，用每秒一次的SIGALRM代替
+static void hz_timer_signal(int sig)
+{
+    hz_timer_tick();
+}
+
+void hz_timer_init(void)
+{
+    struct itimerval timer = {{1, 0}, {1, 0}};
+
+    signal(SIGALRM, hz_timer_signal);
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+#else
 void hz_timer_init(void)
 {
     timer_parameter_struct timer_init_struct;
@@ -143,25 +190,197 @@ void TIMER0_UP_TIMER9_IRQHandler(void)
 {
     if (timer_interrupt_flag_get(TIMER0, TIMER_INT_FLAG_UP) != RESET)
     {
-        // 1. 递减主计时器
-        if (remaining_seconds > 0)
-        {
-            remaining_seconds--;
-        }
+        hz_timer_tick();
+        timer_interrupt_flag_clear(TIMER0, TIMER_INT_FLAG_UP);
+    }
+}
+#endif
+
+// ================== 主循环耗时统计 ==================
+// 每轮主循环按阶段累计实际耗时和I2C总线占用时间，作为优化延迟的基准
+typedef enum
+{
+    LOOP_PHASE_KEY,     // 按键扫描及按键处理
+    LOOP_PHASE_NFC,     // NFC寻卡
+    LOOP_PHASE_PIR,     // 人体红外检测
+    LOOP_PHASE_IMU,     // 敲击检测
+    LOOP_PHASE_REPROBE, // 重新探测模块
+    LOOP_PHASE_STATE,   // 每秒一次的状态机
+    LOOP_PHASE_DISPLAY, // 每秒一次的显示刷新及滚动显示
+    LOOP_PHASE_NUM
+} LoopPhase;
+
+typedef struct
+{
+    unsigned int wall_us; // 累计耗时 (单位: 微秒)
+    unsigned int bus_us;  // 累计的I2C总线占用时间，两条总线之和 (单位: 微秒)
+    unsigned int max_us;  // 单次最长耗时 (单位: 微秒)
+} LoopPhaseStat;
+
+static const char *loop_phase_names[LOOP_PHASE_NUM] = {"key", "nfc", "pir", "imu", "reprobe", "state", "display"};
+static LoopPhaseStat loop_phase_stat[LOOP_PHASE_NUM];
+static unsigned int loop_passes = 0;       // 统计窗口内完成的循环次数
+static unsigned int loop_pass_max_us = 0;  // 最坏一轮的耗时
+static unsigned int loop_window_start = 0; // 统计窗口的开始时间
+static unsigned int loop_pass_start = 0;   // 本轮循环的开始时间
+static unsigned int loop_mark_us = 0;      // 当前阶段的开始时间
+static unsigned int loop_mark_bus = 0;     // 当前阶段开始时的总线占用时间
+static bool loop_pass_skip = false;        // 本轮被统计输出打断，不计入
+static unsigned int key_latency_count = 0; // 统计窗口内测量了延迟的按键数
+static unsigned int key_latency_sum = 0;   // 按键到动作的延迟之和 (单位: 微秒)
+static unsigned int key_latency_max = 0;   // 最长的按键到动作延迟 (单位: 微秒)
+
+static unsigned int loop_bus_busy(void)
+{
+    return i2c_bus_busy_get(I2C0) + i2c_bus_busy_get(I2C1);
+}
+
+// 清除统计，开始新的统计窗口；在循环中调用时本轮不计入
+void loop_prof_reset(void)
+{
+    memset(loop_phase_stat, 0, sizeof(loop_phase_stat));
+    loop_passes = 0;
+    loop_pass_max_us = 0;
+    loop_window_start = delay_time_us();
+    loop_pass_start = loop_window_start;
+    loop_mark_us = loop_window_start;
+    loop_mark_bus = loop_bus_busy();
+    loop_pass_skip = true;
+    key_latency_count = 0;
+    key_latency_sum = 0;
+    key_latency_max = 0;
+}
+
+// 阶段结束：上一个阶段结束以来的耗时和总线占用时间都记到phase
+void loop_prof_phase(LoopPhase phase)
+{
+    unsigned int now = delay_time_us();
+    unsigned int bus = loop_bus_busy();
+    unsigned int wall_us = now - loop_mark_us;
+    LoopPhaseStat *stat = &loop_phase_stat[phase];
+
+    stat->wall_us += wall_us;
+    stat->bus_us += bus - loop_mark_bus;
+    if (wall_us > stat->max_us)
+    {
+        stat->max_us = wall_us;
+    }
+    loop_mark_us = now;
+    loop_mark_bus = bus;
+}
 
-        // 新增：管理UI计时器
-        if (ui_timer_seconds > 0)
+// 一轮循环结束：更新循环次数和最坏一轮的耗时
+void loop_prof_pass(void)
+{
+    unsigned int now = delay_time_us();
+
+    if (!loop_pass_skip)
+    {
+        loop_passes++;
+        if (now - loop_pass_start > loop_pass_max_us)
         {
-            ui_timer_seconds--;
+            loop_pass_max_us = now - loop_pass_start;
         }
+    }
+    loop_pass_skip = false;
+    loop_pass_start = now;
+    loop_mark_us = now;
+    loop_mark_bus = loop_bus_busy();
+}
+
+// 记录一次按键从按下到被处理的延迟
+void loop_prof_key(unsigned int latency_us)
+{
+    key_latency_count++;
+    key_latency_sum += latency_us;
+    if (latency_us > key_latency_max)
+    {
+        key_latency_max = latency_us;
+    }
+}
 
-        // 2. 设置标志位，通知主循环“一秒钟过去了”
-        g_second_has_passed = true;
+// 输出循环频率、最坏一轮、平均一轮，以及各阶段的耗时占比和总线占用时间
+void loop_prof_dump(void (*output)(const char *str))
+{
+    char line[96];
+    unsigned int window_us = loop_pass_start - loop_window_start;
+    e1_tube_stat_t tube_stat;
+    unsigned int total_us = 0;
 
-        timer_interrupt_flag_clear(TIMER0, TIMER_INT_FLAG_UP);
+    for (int i = 0; i < LOOP_PHASE_NUM; i++)
+    {
+        total_us += loop_phase_stat[i].wall_us;
     }
+    snprintf(line, sizeof(line), "loop: %u passes in %ums, %uHz, worst=%uus avg=%uus\r\n",
+             loop_passes, window_us / 1000,
+             window_us ? (unsigned int)((unsigned long long)loop_passes * 1000000 / window_us) : 0,
+             loop_pass_max_us, loop_passes ? window_us / loop_passes : 0);
+    output(line);
+    for (int i = 0; i < LOOP_PHASE_NUM; i++)
+    {
+        const LoopPhaseStat *stat = &loop_phase_stat[i];
+
+        snprintf(line, sizeof(line), "loop %-7s wall=%uus (%u%%) bus=%uus max=%uus\r\n",
+                 loop_phase_names[i], stat->wall_us,
+                 total_us ? (unsigned int)((unsigned long long)stat->wall_us * 100 / total_us) : 0,
+                 stat->bus_us, stat->max_us);
+        output(line);
+    }
+    if (key_latency_count)
+    {
+        snprintf(line, sizeof(line), "loop key->action %u keys, avg=%uus max=%uus\r\n",
+                 key_latency_count, key_latency_sum / key_latency_count, key_latency_max);
+        output(line);
+    }
+    // 数码管只发送改变了的位，统计自上电累计
+    e1_tube_stat_get(&tube_stat);
+    snprintf(line, sizeof(line), "loop tube %u flushes, %u unchanged, %u of %u digits sent\r\n",
+             tube_stat.flushes, tube_stat.unchanged, tube_stat.digits, tube_stat.flushes * E1_TUBE_DIGITS);
+    output(line);
+}
+
+#ifdef BSP_HAL_SIM
+// PC上模拟运行结束时输出统计
+static void loop_prof_exit(void)
+{
+    loop_prof_dump(u1_uart_str_send);
 }
 
+// 显示驱动基准测试：环境变量I2C_SIM_DISPLAY_BENCH设置次数，上电后交替改变LED的三个通道和数码管的全部四位，
+// 输出每次e1_led_rgb_set和e1_tube_str_set的平均和最长耗时；用-DI2C_TIMING_FORCE=I2C_TIMING_GD32编译得到旧的固定间隔的对照
+static void display_bench(void)
+{
+    const char *env = getenv("I2C_SIM_DISPLAY_BENCH");
+    unsigned int count = env ? strtoul(env, 0, 0) : 0;
+    unsigned int led_sum = 0, led_max = 0, tube_sum = 0, tube_max = 0;
+    unsigned int start, us;
+    char line[96];
+
+    if (count == 0)
+    {
+        return;
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        start = delay_time_us();
+        e1_led_rgb_set(e1_led_info, (i % 2) ? 100 : 10, (i % 2) ? 20 : 100, (i % 2) ? 50 : 0);
+        us = delay_elapsed_us(start);
+        led_sum += us;
+        led_max = (us > led_max) ? us : led_max;
+
+        start = delay_time_us();
+        e1_tube_str_set(e1_tube_info, (i % 2) ? "12.34" : "56.78");
+        us = delay_elapsed_us(start);
+        tube_sum += us;
+        tube_max = (us > tube_max) ? us : tube_max;
+    }
+    snprintf(line, sizeof(line), "bench e1_led_rgb_set  %u calls, avg=%uus max=%uus\r\n", count, led_sum / count, led_max);
+    u1_uart_str_send(line);
+    snprintf(line, sizeof(line), "bench e1_tube_str_set %u calls, avg=%uus max=%uus\r\n", count, tube_sum / count, tube_max);
+    u1_uart_str_send(line);
+}
+#endif
+
 // ================== 主函数 ==================
 int main(void)
 {
@@ -173,20 +392,48 @@ int main(void)
         // 持续执行的任务
         handle_inputs();
         perform_continuous_checks();
+        hardware_reprobe();
+        loop_prof_phase(LOOP_PHASE_REPROBE);
+        e1_tube_scroll_poll(e1_tube_info); // 滚动显示按自己的节拍推进，不等待
+        loop_prof_phase(LOOP_PHASE_DISPLAY);
 
         // 每秒执行的任务
         if (g_second_has_passed)
         {
             g_second_has_passed = false;
             update_state_machine();
+            loop_prof_phase(LOOP_PHASE_STATE);
             update_display();
+            loop_prof_phase(LOOP_PHASE_DISPLAY);
+#if I2C_TRACE_ENABLE
+            // 定期输出每个从机的传输次数和耗时分布、主循环各阶段的耗时、模块的总线分配和健康统计，找出占用总线时间最多的驱动和出错的模块
+            static int trace_seconds = 0;
+            if (++trace_seconds >= I2C_TRACE_DUMP_SEC)
+            {
+                trace_seconds = 0;
+                loop_prof_dump(u1_uart_str_send);
+                i2c_trace_dump(u1_uart_str_send, 0);
+                i2c_placement_dump(u1_uart_str_send);
+                i2c_health_dump(u1_uart_str_send);
+                loop_prof_reset(); // 串口输出的耗时不计入统计
+            }
+#endif
         }
+        loop_prof_pass();
     }
 }
 
 // ================== 辅助函数实现 ==================
 void hardware_init(void)
 {
+    unsigned int boot_start;
+
+    delay_init(); // SysTick时间基准，所有驱动的延时和超时都基于它
+    boot_start = delay_time_us();
+#if I2C_TRACE_ENABLE
+    u1_uart_init(115200); // I2C传输统计的输出串口
+#endif
+    i2c_bus_scan(); // 一次扫描两条总线上的所有已知地址，下面的*_init只查注册表
     e1_led_info = e1_led_init();
     e1_tube_info = e1_tube_init();
     e2_fan_info = e2_fan_init();
@@ -198,6 +445,55 @@ void hardware_init(void)
 
     e1_led_rgb_set(e1_led_info, 0, 0, 0);
     e2_fan_speed_set(e2_fan_info, 0);
+    boot_time_us = delay_elapsed_us(boot_start);
+#ifdef BSP_HAL_SIM
+    display_bench();
+    atexit(loop_prof_exit);
+#endif
+    loop_prof_reset();
+}
+
+// 未检测到或已拔出的模块调用驱动接口时直接失败（拔出由I2C层按连续非应答判定）；总线上低频率重新探测，发现新接入的模块后补做初始化
+void hardware_reprobe(void)
+{
+    if (!i2c_bus_rescan())
+    {
+        return;
+    }
+    if (!e1_led_info->flag)
+    {
+        e1_led_info = e1_led_init();
+        e1_led_rgb_set(e1_led_info, 0, 0, 0);
+    }
+    if (!e1_tube_info->flag)
+    {
+        e1_tube_info = e1_tube_init();
+    }
+    if (!e2_fan_info->flag)
+    {
+        e2_fan_info = e2_fan_init();
+        e2_fan_speed_set(e2_fan_info, 0);
+    }
+    if (!s1_key_info->flag)
+    {
+        s1_key_info = s1_key_init();
+    }
+    if (!s2_illuminance_info->flag)
+    {
+        s2_illuminance_info = s2_illuminance_init();
+    }
+    if (!s2_imu_info->flag)
+    {
+        s2_imu_info = s2_imu_init();
+    }
+    if (!s5_nfc_info->flag)
+    {
+        s5_nfc_info = s5_nfc_init();
+    }
+    if (!s7_ir_info->flag)
+    {
+        s7_ir_info = s7_ir_init();
+    }
 }
 
 void enter_setting_edit_mode(SettingType type, int initial_value)
@@ -226,7 +522,7 @@ void enter_setting_edit_mode(SettingType type, int initial_value)
         sprintf(buf, "ERR "); // 错误显示
         break;
     }
-    e1_tube_str_set(e1_tube_info, buf);
+    start_scrolling(buf);
 }
 
 bool apply_setting(void)
@@ -301,9 +597,13 @@ void handle_inputs(void)
     char current_key = s1_key_value_get(s1_key_info);
     if (current_key != last_key_pressed && current_key != SWN)
     {
+#ifdef BSP_HAL_SIM
+        loop_prof_key(i2c_sim_key_age_us()); // 按键基准测试：模拟按下到这里的延迟
+#endif
         handle_keypad_input(current_key); // 调用原来的处理函数
     }
     last_key_pressed = current_key;
+    loop_prof_phase(LOOP_PHASE_KEY);
 
     // --- NFC输入处理 ---
     // 只有在特定状态下才检测NFC
@@ -315,7 +615,8 @@ void handle_inputs(void)
         currentState == STATE_BINDING_DATA)
     {
         unsigned char card_type[2];
-        if (s5_nfc_request(s5_nfc_info, 0x26, card_type) == MI_OK)
+        char nfc_status = s5_nfc_request(s5_nfc_info, 0x26, card_type);
+        if (nfc_status == MI_OK)
         {
             if (s5_nfc_anticoll(s5_nfc_info, last_read_card_id) == MI_OK)
             {
@@ -355,6 +656,10 @@ void handle_inputs(void)
                 }
             }
         }
+        else if (nfc_status == MI_YIELD)
+        {
+            // 寻卡被按键打断，不算没有卡，下一轮重试
+        }
         else if (currentState >= STATE_BINDING_STUDY && currentState <= STATE_BINDING_DATA && ui_timer_seconds <= 0)
         {
             // 如果处于绑定状态但长时间没有检测到卡，则超时失败
@@ -362,6 +667,7 @@ void handle_inputs(void)
             ui_timer_seconds = 2;
         }
     }
+    loop_prof_phase(LOOP_PHASE_NFC);
 }
 
 void load_task_mode(const unsigned char *card_uid)
@@ -450,23 +756,9 @@ void update_state_machine(void)
         }
         break;
     case STATE_LOW_LIGHT_WARNING:
-        if (ui_timer_seconds <= 0 && flash_count > 0)
-        {
-            if (flash_count % 2 == 0)
-            {
-                e1_led_rgb_set(e1_led_info, 100, 100, 0); // 黄灯亮
-            }
-            else
-            {
-                e1_led_rgb_set(e1_led_info, 0, 0, 0); // 黄灯灭
-            }
-            flash_count--;
-            ui_timer_seconds = 1; // 重置1秒计时器
-        }
-
-        if (flash_count <= 0)
+        if (ui_timer_seconds <= 0)
         {
-            // 闪烁结束，正式进入专注模式
+            // 警告结束，正式进入专注模式，数码管的闪烁在update_display中关闭
             currentState = STATE_FOCUS;
             remaining_seconds = focus_duration_sec;
             e2_fan_speed_set(e2_fan_info, FAN_SPEED_LOW);
@@ -541,6 +833,7 @@ void perform_continuous_checks(void)
                 e2_fan_speed_set(e2_fan_info, FAN_SPEED_HIGH);
         }
     }
+    loop_prof_phase(LOOP_PHASE_PIR);
 
     // 敲击检测
     if (currentState == STATE_FOCUS || currentState == STATE_MANUAL_PAUSE)
@@ -579,6 +872,17 @@ void perform_continuous_checks(void)
             }
         }
     }
+
+    // 下一轮要读的I2C1传感器先提交，读操作与其间I2C0上的显示、按键和NFC传输同时进行
+    if (currentState == STATE_FOCUS || currentState == STATE_AUTO_PAUSE)
+    {
+        s7_ir_status_prefetch(s7_ir_info);
+    }
+    if (currentState == STATE_FOCUS || currentState == STATE_MANUAL_PAUSE)
+    {
+        s2_imu_value_prefetch(s2_imu_info);
+    }
+    loop_prof_phase(LOOP_PHASE_IMU);
 }
 
 void start_focus_mode(void)
@@ -586,10 +890,11 @@ void start_focus_mode(void)
     unsigned int current_illuminance = s2_illuminance_value_get(s2_illuminance_info);
     if (current_illuminance < low_light_threshold)
     {
-        e1_tube_str_set(e1_tube_info, "LItE Lo");
         currentState = STATE_LOW_LIGHT_WARNING;
-        flash_count = 6;      // 闪烁3次（亮+灭=2，所以3*2=6）
-        ui_timer_seconds = 1; // 每秒切换一次亮/灭
+        start_scrolling("LItE Lo");
+        update_display_mode();                    // 闪烁只设置一次，由数码管芯片完成
+        e1_led_rgb_set(e1_led_info, 100, 100, 0); // 黄灯
+        ui_timer_seconds = LOW_LIGHT_WARNING_SEC;
     }
     else
     {
@@ -607,10 +912,48 @@ void start_rest_mode(void)
     e2_fan_speed_set(e2_fan_info, 0);
 }
 
+// 超过四位的文字在数码管上循环滚动，主循环每轮调用e1_tube_scroll_poll推进；不超过四位时直接显示
+// 倒计时优先：计时状态下不启动滚动，倒计时每秒的e1_tube_str_set也会替换正在滚动的文字
+void start_scrolling(const char *text)
+{
+    if (currentState == STATE_FOCUS || currentState == STATE_REST || currentState == STATE_LONG_REST)
+    {
+        return;
+    }
+    e1_tube_scroll_start(e1_tube_info, text);
+}
+
+void stop_scrolling(void)
+{
+    e1_tube_scroll_stop();
+}
+
+// 数码管的闪烁和亮度由HT16K33完成，这里按状态选择，只在改变时发送命令：低光照警告快闪，暂停时变暗并慢闪
+void update_display_mode(void)
+{
+    switch (currentState)
+    {
+    case STATE_LOW_LIGHT_WARNING:
+        e1_tube_blink_set(e1_tube_info, E1_TUBE_BLINK_1HZ);
+        e1_tube_bright_set(e1_tube_info, E1_TUBE_BRIGHT_MAX);
+        break;
+    case STATE_AUTO_PAUSE:
+    case STATE_MANUAL_PAUSE:
+        e1_tube_blink_set(e1_tube_info, E1_TUBE_BLINK_HALF_HZ);
+        e1_tube_bright_set(e1_tube_info, TUBE_BRIGHT_PAUSE);
+        break;
+    default:
+        e1_tube_blink_set(e1_tube_info, E1_TUBE_BLINK_OFF);
+        e1_tube_bright_set(e1_tube_info, E1_TUBE_BRIGHT_MAX);
+        break;
+    }
+}
+
 void update_display(void)
 {
     char buf[10];
 
+    update_display_mode();
     switch (currentState)
     {
     case STATE_IDLE:
@@ -640,7 +983,7 @@ void update_display(void)
     case STATE_SHOW_STATS:
         e1_led_rgb_set(e1_led_info, 100, 100, 100); // 白
         sprintf(buf, "donE%02d", completed_sessions);
-        e1_tube_str_set(e1_tube_info, buf);
+        start_scrolling(buf);
         break;
     case STATE_NFC_READ:
         e1_led_rgb_set(e1_led_info, 0, 100, 100); // 青
@@ -734,7 +1077,7 @@ void handle_keypad_input(char key)
             currentState = STATE_TEMP_DISPLAY;  // 切换到临时显示状态
             ui_timer_seconds = 2;               // 设置显示时长为2秒
             sprintf(buf, "FAn %d", fan_level);  // 准备要显示的内容
-            e1_tube_str_set(e1_tube_info, buf); // 立即更新数码管
+            start_scrolling(buf);               // 立即更新数码管
         }
         else if (key == '9') // 开发者功能：跳过当前阶段
         {
@@ -808,7 +1151,7 @@ void handle_keypad_input(char key)
         {
             currentState = STATE_SET_MENU_MAIN;
             setting_menu_index = 0;                  // 默认显示第一个菜单项
-            e1_tube_str_set(e1_tube_info, "SET---"); // 初始显示
+            start_scrolling("SET---");               // 初始显示
         }
         else if (key == '0')
         { // 按0进入绑定模式
@@ -1,7 +1,20 @@
 #ifndef DELAY_H
 #define DELAY_H
 
+#ifndef BSP_HAL_SIM
+#include "gd32f4xx.h"
+#endif
+
+/* 时间基准函数声明 */
+void delay_init(void);
+unsigned int delay_time_ms(void);
+unsigned int delay_time_us(void);
+unsigned int delay_elapsed_us(unsigned int start);
+unsigned int delay_deadline(unsigned int us);
+int delay_expired(unsigned int deadline);
+
 /* 延时函数声明 */
+void delay_us(unsigned int us);
 void delay_ms(unsigned int ms);
 
 #endif /* DELAY_H */
@@ -5,18 +5,46 @@
 #include "i2c.h"
 
 /* LED灯从机信息 */
-extern i2c_slave_info e1_led_info;
+extern i2c_slave_info * e1_led_info;
 
 /* LED灯函数声明 */
-i2c_slave_info e1_led_init(void);
-void e1_led_rgb_set(i2c_slave_info info, unsigned char red, unsigned char green, unsigned char blue);
+i2c_slave_info * e1_led_init(void);
+void e1_led_rgb_set(i2c_slave_info * info, unsigned char red, unsigned char green, unsigned char blue);
+
+/* 数码管位数 */
+#define E1_TUBE_DIGITS     4
+/* 滚动显示：超过四位的文字每隔E1_TUBE_SCROLL_MS左移一位，末尾空E1_TUBE_SCROLL_GAP位后循环，最多E1_TUBE_SCROLL_LEN个字符 */
+#define E1_TUBE_SCROLL_MS   300
+#define E1_TUBE_SCROLL_GAP  2
+#define E1_TUBE_SCROLL_LEN  32
+/* 数码管硬件闪烁方式（HT16K33显示设置命令0x81/0x83/0x85/0x87），由芯片自己闪烁，不占用总线 */
+#define E1_TUBE_BLINK_OFF      0
+#define E1_TUBE_BLINK_2HZ      1
+#define E1_TUBE_BLINK_1HZ      2
+#define E1_TUBE_BLINK_HALF_HZ  3
+/* 数码管亮度等级0~15（HT16K33亮度命令0xE0~0xEF，占空比(n+1)/16），上电为最亮 */
+#define E1_TUBE_BRIGHT_MAX     15
+
+/* 数码管刷新统计 */
+typedef struct
+{
+	unsigned int flushes;   /* 刷新次数 */
+	unsigned int unchanged; /* 没有位改变、未访问总线的刷新次数 */
+	unsigned int digits;    /* 发送的位数，未改变的位夹在改变的位之间时随同发送 */
+}e1_tube_stat_t;
 
 /* 数码管从机信息 */
-extern i2c_slave_info e1_tube_info;
+extern i2c_slave_info * e1_tube_info;
 
 /* 数码管函数声明 */
-i2c_slave_info e1_tube_init(void);
-void e1_tube_str_set(i2c_slave_info info, char * str);
+i2c_slave_info * e1_tube_init(void);
+void e1_tube_str_set(i2c_slave_info * info, char * str);
+void e1_tube_scroll_start(i2c_slave_info * info, const char * str);
+void e1_tube_scroll_stop(void);
+int e1_tube_scroll_poll(i2c_slave_info * info);
+int e1_tube_blink_set(i2c_slave_info * info, unsigned char blink);
+int e1_tube_bright_set(i2c_slave_info * info, unsigned char level);
+void e1_tube_stat_get(e1_tube_stat_t * stat);
 
 #endif /* E1_H */
 
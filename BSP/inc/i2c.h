@@ -1,35 +1,348 @@
 #ifndef I2C_H
 #define I2C_H
 
+#include <stdio.h>
+#ifdef BSP_HAL_SIM
+/* PC上模拟运行时没有GD32的头文件，接口仍用GD32的I2C基地址表示 */
+#define I2C0               0x40005400U
+#define I2C1               0x40005800U
+#else
 #include "gd32f4xx.h"
+#endif
+#include "delay.h"
 
 /* I2C接口 */
 const static unsigned int I2C_PERIPH_NUM[] = {I2C0, I2C1};
 
-/* I2C参数 */
-#define I2C0_SPEED         100000
+/* I2C时钟速度 */
+#define I2C_SPEED_STD      100000 /* 标准模式 */
+#define I2C_SPEED_FAST     400000 /* 快速模式 */
+
+/* I2C参数，I2Cx_SPEED为总线扫描时的时钟速度，扫描后按从机支持的最高速度重新配置 */
+#define I2C0_SPEED         I2C_SPEED_STD
 #define I2C0_SLAVE_ADDR    0xA0
 
-#define I2C1_SPEED         100000
+#define I2C1_SPEED         I2C_SPEED_STD
 #define I2C1_SLAVE_ADDR    0xA0
 
-/* I2C从机信息 */
+/* I2C时钟降速：每I2C_SPEED_ERROR_WINDOW次传输中总线错误达到I2C_SPEED_ERROR_LIMIT次时时钟速度减半，最低为标准模式 */
+#define I2C_SPEED_ERROR_LIMIT   4
+#define I2C_SPEED_ERROR_WINDOW  256
+
+/* I2C超时：每个传输的时限为按标准模式计算的线上时间加上寄存器间隔，再加I2C_TIMEOUT_US的余量；
+   总线挂死时阻塞式调用最长为(I2C_RETRY_MAX+1)个时限加重试等待，如LED灯12字节写入约6.4ms，挂死一次约6.7ms，
+   从机同时拉住SCL使下一次也超时约13.4ms（模拟后端I2C_SIM_STUCK实测） */
+#define I2C_TIMEOUT_US     5000
+/* 启动传输时在中断中等待上一次停止信号完成的最长时间，超过后交给i2c_xfer_poll继续等待 */
+#define I2C_BUSY_SPIN_US   20
+
+/* I2C热插拔监视：每I2C_RESCAN_MS毫秒探测一个尚未找到的模块的一个候选地址，每次约占用0.1ms总线时间；
+   已找到的从机连续I2C_DETACH_LIMIT次传输非应答或超时即判定为已拔出，之后的访问直接失败，不再占用总线 */
+#define I2C_RESCAN_MS      50
+#define I2C_DETACH_LIMIT   3
+
+/* I2C阻塞式传输的重试：失败后最多重试I2C_RETRY_MAX次，第n次重试前等待I2C_RETRY_BACKOFF_US<<(n-1)微秒，
+   等待期间其他总线上的传输照常进行；已判定为拔出的从机不再重试。异步传输（预取、周期传输）不重试 */
+#define I2C_RETRY_MAX        2
+#define I2C_RETRY_BACKOFF_US 200
+
+/* I2C DMA模式，1表示使能，0表示关闭；数据个数不少于I2C_DMA_MIN_COUNT时使用DMA传输 */
+#define I2C_DMA_ENABLE     1
+#define I2C_DMA_MIN_COUNT  2
+
+/* I2C传输优先级，数值越小越优先：同一总线上排队的传输按优先级出队，同一优先级按提交顺序，正在进行的传输不被打断 */
+#define I2C_PRIO_INPUT     0 /* 交互输入，如按键 */
+#define I2C_PRIO_ACTUATOR  1 /* 执行器，如LED、数码管、风扇 */
+#define I2C_PRIO_SENSOR    2 /* 后台传感器，从机默认的优先级 */
+#define I2C_PRIO_NFC       3 /* NFC等由几十次传输组成的长序列 */
+#define I2C_PRIO_NUM       4
+
+/* 向量写一次传输最多的段数 */
+#define I2C_SEG_MAX        16
+
+/* I2C预取结果的有效期（微秒），超过后驱动改为阻塞读取 */
+#define I2C_PREFETCH_MAX_US 20000
+
+/* I2C寄存器影子缓存，1表示使能，0表示关闭；每个缓存最多覆盖I2C_SHADOW_MAX个连续的寄存器 */
+#define I2C_SHADOW_ENABLE  1
+#define I2C_SHADOW_MAX     64
+
+/* I2C写合并，1表示使能，0表示关闭；每个合并缓冲最多暂存I2C_COALESCE_MAX个连续寄存器的数据 */
+#define I2C_COALESCE_ENABLE 1
+#define I2C_COALESCE_MAX   16
+
+/* I2C传输跟踪，1表示使能，0表示关闭；记录最近I2C_TRACE_DEPTH次传输，并按从机统计耗时直方图 */
+#define I2C_TRACE_ENABLE   1
+#define I2C_TRACE_DEPTH    64
+#define I2C_TRACE_DEV_MAX  16 /* 统计的从机个数，超出的从机不统计 */
+#define I2C_TRACE_BUCKETS  16 /* 耗时直方图的桶数，第n个桶统计[2^n, 2^(n+1))微秒，最后一个桶包括更长的耗时 */
+
+/* I2C从机时序要求（微秒） */
 typedef struct
 {
-	unsigned int periph; /* 从机接口 */
-	unsigned char addr;  /* 从机地址 */
-	unsigned char flag;  /* 从机状态，0表示从机不存在，1表示从机存在 */
+	unsigned short gap;  /* 写操作中寄存器地址与数据之间的间隔 */
+	unsigned short hold; /* 写操作完成后到下一次访问之间的间隔 */
+}i2c_timing;
+
+/* I2C从机时序类型，作为I2C_TIMING_TAB的下标 */
+#define I2C_TIMING_NONE    0 /* 无时序要求，如PCA9685、HT16K33 */
+#define I2C_TIMING_GD32    1 /* GD32从机模块（s6、s11、e3），由固件处理寄存器地址 */
+/* 基准测试用：编译时定义I2C_TIMING_FORCE后所有模块使用同一时序类型，如-DI2C_TIMING_FORCE=I2C_TIMING_GD32
+   恢复每次写入都等待2ms寄存器间隔的旧行为，与按模块的时序对比耗时 */
+
+/* I2C地址格式：GD32F450/GD32F470上使用左移一位的8位地址，模块表中统一写7位地址 */
+#if defined (GD32F450) || defined (GD32F470)
+#define I2C_ADDR_SHIFT     1
+#else
+#define I2C_ADDR_SHIFT     0
+#endif
+
+/* I2C模块表，每个模块一行：标识、名称、支持的最高时钟速度、时序类型、传输优先级、候选地址（7位，最多I2C_DEV_ADDR_MAX个）；
+   总线扫描的探测表、每个模块的从机槽位和驱动的查找都由这张表生成，增加模块只需增加一行。
+   GD32从机模块的固件未说明快速模式支持，按标准模式处理 */
+#define I2C_DEV_ADDR_MAX   4
+#define I2C_DEV_LIST(X) \
+	X(E1_LED,     "e1 led",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_ACTUATOR, 0x60, 0x61, 0x62, 0x63) /* PCA9685 */   \
+	X(E1_TUBE,    "e1 tube",    I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_ACTUATOR, 0x70, 0x71, 0x72, 0x73) /* HT16K33 */   \
+	X(E2_FAN,     "e2 fan",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_ACTUATOR, 0x64, 0x65, 0x66, 0x67) /* PCA9685 */   \
+	X(E3_CURTAIN, "e3 curtain", I2C_SPEED_STD,  I2C_TIMING_GD32, I2C_PRIO_ACTUATOR, 0x1C, 0x1D, 0x1E, 0x1F) /* GD32 */      \
+	X(S1_KEY,     "s1 key",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_INPUT,    0x74, 0x75, 0x76, 0x77) /* HT16K33 */   \
+	X(S2_LIGHT,   "s2 light",   I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_SENSOR,   0x23, 0x5C)             /* BH1750 */    \
+	X(THS,        "s2/s8 ths",  I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_SENSOR,   0x44, 0x45)             /* SHT3x */     \
+	X(S2_IMU,     "s2 imu",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_SENSOR,   0x68, 0x69)             /* ICM20608 */  \
+	X(S5_NFC,     "s5 nfc",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_NFC,      0x28, 0x29, 0x2A, 0x2B) /* MS523 */     \
+	X(S6_SONIC,   "s6 sonic",   I2C_SPEED_STD,  I2C_TIMING_GD32, I2C_PRIO_SENSOR,   0x2C, 0x2D, 0x2E, 0x2F) /* GD32 */      \
+	X(S7_PIR,     "s7 pir",     I2C_SPEED_FAST, I2C_TIMING_NONE, I2C_PRIO_SENSOR,   0x18, 0x19, 0x1A, 0x1B) /* PCA9557 */   \
+	X(S11_WEIGHT, "s11 weight", I2C_SPEED_STD,  I2C_TIMING_GD32, I2C_PRIO_SENSOR,   0x30, 0x31, 0x32, 0x33) /* GD32 */
+
+/* I2C模块标识，即模块在模块表中的下标 */
+#define I2C_DEV_ENUM(id, name, speed, timing, prio, ...) I2C_DEV_##id,
+typedef enum
+{
+	I2C_DEV_LIST(I2C_DEV_ENUM)
+	I2C_DEV_NUM
+}i2c_dev_id;
+
+typedef struct i2c_shadow i2c_shadow;
+typedef struct i2c_coalesce i2c_coalesce;
+
+/* I2C从机健康统计：在传输结束时更新，运行时可随时读取，用于在接线或模块老化造成延迟尖峰或执行器失灵之前发现问题 */
+typedef struct
+{
+	unsigned int xfers;      /* 传输次数，每次重试也计一次 */
+	unsigned int nack;       /* 非应答次数 */
+	unsigned int timeout;    /* 超时次数，即总线挂死后由后端恢复的次数 */
+	unsigned int bus_error;  /* 仲裁丢失和总线错误次数 */
+	unsigned int retry;      /* 重试次数 */
+	unsigned int recovered;  /* 重试后成功的阻塞式传输次数 */
+	unsigned int failed;     /* 重试用尽仍失败的阻塞式传输次数 */
+}i2c_health;
+
+/* I2C从机信息，即从机注册表中的一项：模块的从机槽位由i2c_dev_lookup返回其指针，驱动和所有I2C函数都通过指针访问，
+   不复制；影子缓存、写合并缓冲和错误统计都挂在这一项上 */
+typedef struct
+{
+	unsigned int periph;     /* 从机接口 */
+	unsigned char addr;      /* 从机地址 */
+	unsigned char flag;      /* 从机状态，0表示从机不存在，1表示从机存在 */
+	unsigned char timing;    /* 从机时序类型，I2C_TIMING_x */
+	unsigned char prio;      /* 传输优先级，I2C_PRIO_x */
+	unsigned char fail_run;  /* 连续非应答或超时的传输次数 */
+	i2c_shadow * shadow;     /* 影子缓存链表，NULL表示没有 */
+	i2c_coalesce * coalesce; /* 写合并缓冲，NULL表示没有 */
+	i2c_health health;       /* 健康统计 */
 }i2c_slave_info;
 
+/* I2C总线扫描统计 */
+typedef struct
+{
+	unsigned int probe_count; /* 探测的地址数 */
+	unsigned int found_count; /* 应答的从机数 */
+	unsigned int scan_us;     /* 扫描耗时（微秒），包括I2C初始化 */
+	unsigned int attach_count;/* 热插拔监视发现的从机数 */
+	unsigned int detach_count;/* 判定为已拔出的从机数 */
+}i2c_scan_stat_t;
+
+extern i2c_scan_stat_t i2c_scan_stat;
+
+/* I2C传输标志 */
+#define I2C_XFER_REG       0x01 /* 数据之前先发送寄存器地址 */
+#define I2C_XFER_READ      0x02 /* 数据阶段为主机接收，否则为主机发送 */
+
+/* I2C传输状态 */
+#define I2C_XFER_IDLE      0    /* 未提交 */
+#define I2C_XFER_PENDING   1    /* 排队中或传输中 */
+#define I2C_XFER_DONE      2    /* 传输成功 */
+#define I2C_XFER_ERROR     3    /* 传输失败，不小于此值的状态都表示失败 */
+#define I2C_XFER_NACK      4    /* 从机非应答 */
+#define I2C_XFER_ARLO      5    /* 仲裁丢失 */
+#define I2C_XFER_BERR      6    /* 总线错误 */
+#define I2C_XFER_TIMEOUT   7    /* 传输超时，总线已复位 */
+
+/* 向量写的一段：寄存器地址和紧随其后写入的数据 */
+typedef struct
+{
+	unsigned char reg;             /* 寄存器地址 */
+	unsigned char * pbytes;        /* 数据缓冲区 */
+	unsigned char count;           /* 数据个数 */
+}i2c_seg;
+
+typedef struct i2c_xfer i2c_xfer;
+
+/* I2C传输完成回调，在I2C中断中执行 */
+typedef void (*i2c_xfer_callback)(i2c_xfer * xfer);
+
+/* I2C传输描述，提交后直到完成前不得修改或释放 */
+struct i2c_xfer
+{
+	unsigned int periph;           /* 从机接口 */
+	unsigned char addr;            /* 从机地址 */
+	unsigned char flags;           /* 传输标志 */
+	unsigned char prio;            /* 传输优先级 */
+	unsigned char reg;             /* 寄存器地址 */
+	unsigned short gap;            /* 寄存器地址与数据之间的间隔（微秒） */
+	unsigned short hold;           /* 写操作完成后占用总线的时间（微秒） */
+	unsigned char * pbytes;        /* 数据缓冲区 */
+	unsigned char count;           /* 数据个数 */
+	const i2c_seg * segs;          /* 写操作的后续段，每段以重复起始信号开始，不释放总线；NULL表示没有 */
+	unsigned char seg_num;         /* 后续段的个数 */
+	i2c_slave_info * slave;        /* 从机信息，传输结束时更新其健康统计，内部使用 */
+	volatile unsigned char status; /* 传输状态 */
+	i2c_xfer_callback callback;    /* 完成回调，可为NULL */
+	void * arg;                    /* 回调参数 */
+	i2c_xfer * next;               /* 队列链接，内部使用 */
+};
+
+typedef struct i2c_periodic i2c_periodic;
+
+/* I2C周期传输完成回调，在i2c_xfer_poll中执行，不在中断中 */
+typedef void (*i2c_periodic_callback)(i2c_periodic * periodic);
+
+/* I2C周期传输：由i2c_xfer_poll按周期自动提交，用于按键等需要及时采样的输入，
+   它插在其他驱动的两次传输之间，不需要等主循环转回来 */
+struct i2c_periodic
+{
+	i2c_xfer xfer;                   /* 周期提交的传输，由驱动用i2c_xfer_init初始化 */
+	unsigned int period;             /* 周期（微秒） */
+	unsigned int due;                /* 下一次提交的时间（微秒），内部使用 */
+	unsigned char active;            /* 已提交、回调尚未执行，内部使用 */
+	i2c_periodic_callback callback;  /* 完成回调，可为NULL */
+	void * arg;                      /* 回调参数 */
+	i2c_periodic * next;             /* 周期传输链表，内部使用 */
+};
+
+/* I2C寄存器预取：驱动提前提交下一次要用的读操作，与另一条总线上的传输同时进行，用到时再取结果 */
+typedef struct
+{
+	i2c_xfer xfer;      /* 读操作 */
+	unsigned int time;  /* 提交时间（微秒） */
+}i2c_prefetch;
+
+/* I2C寄存器影子缓存：驱动为一段连续的可缓存寄存器（值只由主机写入改变）定义一个缓存，
+   写入与影子值相同的数据时不访问总线，读取时从影子值返回 */
+struct i2c_shadow
+{
+	unsigned char first;                   /* 第一个寄存器的地址 */
+	unsigned char count;                   /* 寄存器个数，不超过I2C_SHADOW_MAX */
+	unsigned char regs[I2C_SHADOW_MAX];    /* 影子值 */
+	unsigned char valid[I2C_SHADOW_MAX/8]; /* 影子值是否有效的位图 */
+	unsigned int hit;                      /* 命中次数，即省去的总线传输次数 */
+	unsigned int miss;                     /* 未命中次数 */
+	i2c_shadow * next;                     /* 同一从机的缓存链表，内部使用 */
+};
+
+/* I2C写合并缓冲：驱动为支持寄存器地址自动递增的从机定义一个缓冲，对相邻寄存器的连续写入暂存在缓冲中，
+   刷新时作为一次突发写入发送；访问该从机的其他操作和i2c_coalesce_flush都会刷新 */
+struct i2c_coalesce
+{
+	i2c_slave_info * info;                 /* 从机信息 */
+	unsigned char reg;                     /* 暂存数据的起始寄存器地址 */
+	unsigned char count;                   /* 暂存的数据个数，0表示没有暂存数据 */
+	unsigned char bytes[I2C_COALESCE_MAX]; /* 暂存的数据 */
+	unsigned int merged;                   /* 并入已有暂存数据的写入次数，即省去的总线传输次数 */
+	unsigned int flushed;                  /* 刷新时发送的突发写入次数 */
+};
+
+/* I2C传输跟踪记录 */
+typedef struct
+{
+	unsigned int time;      /* 启动时间（微秒） */
+	unsigned int duration;  /* 总线占用时间（微秒），从等待总线空闲到传输结束 */
+	unsigned char bus;      /* 接口序号，I2C_PERIPH_NUM的下标 */
+	unsigned char addr;     /* 从机地址 */
+	unsigned char reg;      /* 寄存器的地址，flags不含I2C_XFER_REG时无意义 */
+	unsigned char flags;    /* 传输标志 */
+	unsigned char count;    /* 数据个数 */
+	unsigned char status;   /* 传输状态 */
+}i2c_trace_entry;
+
+/* I2C从机传输统计 */
+typedef struct
+{
+	unsigned char bus;      /* 接口序号 */
+	unsigned char addr;     /* 从机地址 */
+	unsigned int calls;     /* 传输次数 */
+	unsigned int errors;    /* 失败次数 */
+	unsigned int bytes;     /* 数据字节总数 */
+	unsigned int total_us;  /* 总线占用时间总和（微秒） */
+	unsigned int max_us;    /* 最长的一次（微秒） */
+	unsigned int hist[I2C_TRACE_BUCKETS]; /* 耗时直方图 */
+}i2c_trace_dev;
+
+/* 跟踪输出函数，每次输出一行 */
+typedef void (*i2c_trace_output)(const char * str);
+
 /* I2C函数声明 */
-void i2c_delay_ms(unsigned int ms);
 void i2c_init(void);
 i2c_slave_info i2c_slave_detect(unsigned int periph, unsigned char addr);
-int i2c_byte_write(i2c_slave_info info, unsigned char byte);
-int i2c_reg_byte_write(i2c_slave_info info, unsigned char reg, unsigned char byte);
-int i2c_reg_bytes_write(i2c_slave_info info, unsigned char reg, unsigned char * pbytes, unsigned char count);
-int i2c_bytes_read(i2c_slave_info info, unsigned char * pbytes, unsigned char count);
-int i2c_reg_bytes_read(i2c_slave_info info, unsigned char reg, unsigned char * pbytes, unsigned char count);
+void i2c_bus_scan(void);
+int i2c_slave_present(unsigned int periph, unsigned char addr);
+int i2c_bus_rescan(void);
+unsigned int i2c_bus_speed_get(unsigned int periph);
+unsigned int i2c_bus_busy_get(unsigned int periph);
+void i2c_placement_dump(i2c_trace_output output);
+void i2c_health_dump(i2c_trace_output output);
+i2c_slave_info * i2c_dev_lookup(i2c_dev_id id);
+int i2c_byte_write(i2c_slave_info * info, unsigned char byte);
+int i2c_reg_byte_write(i2c_slave_info * info, unsigned char reg, unsigned char byte);
+int i2c_reg_bytes_write(i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count);
+int i2c_reg_segs_write(i2c_slave_info * info, const i2c_seg * segs, unsigned char num);
+int i2c_bytes_read(i2c_slave_info * info, unsigned char * pbytes, unsigned char count);
+int i2c_reg_bytes_read(i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count);
+
+/* I2C寄存器影子缓存函数声明 */
+void i2c_shadow_attach(i2c_shadow * shadow, i2c_slave_info * info, unsigned char first, unsigned char count);
+void i2c_shadow_invalidate(i2c_slave_info * info);
+void i2c_shadow_stat_get(unsigned int * hit, unsigned int * miss);
+
+/* I2C写合并函数声明 */
+void i2c_coalesce_attach(i2c_coalesce * coalesce, i2c_slave_info * info);
+int i2c_coalesce_flush(i2c_slave_info * info);
+int i2c_coalesce_flush_all(void);
+void i2c_coalesce_stat_get(unsigned int * merged, unsigned int * flushed);
+
+/* I2C传输跟踪函数声明 */
+int i2c_trace_entry_get(unsigned int index, i2c_trace_entry * entry);
+const i2c_trace_dev * i2c_trace_dev_get(unsigned int index);
+unsigned int i2c_trace_percentile(const i2c_trace_dev * dev, unsigned int percent);
+void i2c_trace_dump(i2c_trace_output output, int entries);
+void i2c_trace_reset(void);
+
+/* I2C异步传输函数声明 */
+void i2c_xfer_init(i2c_xfer * xfer, i2c_slave_info * info, unsigned char flags, unsigned char reg, unsigned char * pbytes, unsigned char count);
+int i2c_xfer_submit(i2c_xfer * xfer);
+int i2c_xfer_wait(i2c_xfer * xfer);
+void i2c_xfer_poll(void);
+
+/* I2C预取函数声明 */
+int i2c_prefetch_start(i2c_prefetch * prefetch, i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count);
+int i2c_prefetch_take(i2c_prefetch * prefetch);
+
+/* I2C调度函数声明 */
+void i2c_periodic_start(i2c_periodic * periodic, unsigned int period);
+void i2c_yield_request(unsigned char prio);
+void i2c_yield_clear(unsigned char prio);
+int i2c_yield_check(unsigned char prio);
 
 #endif /* I2C_H */
 
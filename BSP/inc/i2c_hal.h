@@ -0,0 +1,43 @@
+#ifndef I2C_HAL_H
+#define I2C_HAL_H
+
+#include "i2c.h"
+
+/*
+	I2C总线硬件抽象层：i2c.c只负责传输队列、超时、速度协商、跟踪和影子缓存，
+	线上的时序由后端完成。总线用I2C_PERIPH_NUM中的下标表示。
+	后端：i2c_hal_gd32.c（GD32F4xx中断+DMA，默认）
+	      i2c_hal_sim.c （定义BSP_HAL_SIM时，在PC上用模拟从机运行驱动和主程序）
+*/
+
+/* 由i2c.c提供，后端在中断中调用 */
+void i2c_hal_gap(unsigned char bus);
+void i2c_hal_done(unsigned char bus, unsigned char status);
+
+/* 由后端提供 */
+void i2c_hal_init(void);
+void i2c_hal_speed_set(unsigned char bus, unsigned int speed);
+int i2c_hal_busy(unsigned char bus);
+void i2c_hal_start(unsigned char bus, i2c_xfer * xfer);
+void i2c_hal_resume(unsigned char bus);
+void i2c_hal_stop(unsigned char bus);
+void i2c_hal_recover(unsigned char bus);
+unsigned int i2c_hal_irq_save(void);
+void i2c_hal_irq_restore(unsigned int state);
+void i2c_hal_poll(void);
+
+#ifdef BSP_HAL_SIM
+/* 模拟从机的控制接口，供PC上的回归测试和性能测试设置输入、检查输出 */
+void i2c_sim_present_set(unsigned char bus, unsigned char addr, int present);
+void i2c_sim_stuck_set(unsigned char bus, unsigned char addr, unsigned int count, unsigned int scl_ms);
+void i2c_sim_key_set(char key);
+unsigned int i2c_sim_key_age_us(void);
+void i2c_sim_card_set(const unsigned char * uid);
+void i2c_sim_light_set(unsigned int lux);
+void i2c_sim_ths_set(float temp, float humi);
+void i2c_sim_accel_set(short x, short y, short z);
+void i2c_sim_ir_set(unsigned char status);
+int i2c_sim_ram_get(unsigned char bus, unsigned char addr, unsigned char reg, unsigned char * pbytes, unsigned char count);
+#endif
+
+#endif /* I2C_HAL_H */
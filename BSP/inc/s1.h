@@ -18,11 +18,14 @@
 #define SW11    ('0')
 #define SW12    ('#')
 
+/* 后台按键扫描的周期（微秒），决定按键被采样到的最长延迟 */
+#define S1_KEY_SCAN_US  5000
+
 /* 按键从机信息 */
-extern i2c_slave_info s1_key_info;
+extern i2c_slave_info * s1_key_info;
 
 /* 按键函数声明 */
-i2c_slave_info s1_key_init(void);
-char s1_key_value_get(i2c_slave_info info);
+i2c_slave_info * s1_key_init(void);
+char s1_key_value_get(i2c_slave_info * info);
 
 #endif /* S1_H */
@@ -2,13 +2,14 @@
 #define S2_H
 
 #include "i2c.h"
+#include "delay.h"
 
 /* 光照强度传感器从机信息 */
-extern i2c_slave_info s2_illuminance_info;
+extern i2c_slave_info * s2_illuminance_info;
 
 /* 光照强度传感器函数声明 */
-i2c_slave_info s2_illuminance_init(void);
-unsigned int s2_illuminance_value_get(i2c_slave_info info);
+i2c_slave_info * s2_illuminance_init(void);
+unsigned int s2_illuminance_value_get(i2c_slave_info * info);
 
 /* 温湿度传感器测量结果 */
 typedef struct
@@ -18,11 +19,11 @@ typedef struct
 }s2_ths_t;
 
 /* 温湿度传感器从机信息 */
-extern i2c_slave_info s2_ths_info;
+extern i2c_slave_info * s2_ths_info;
 
 /* 温湿度传感器函数声明 */
-i2c_slave_info s2_ths_init(void);
-s2_ths_t s2_ths_value_get(i2c_slave_info info);
+i2c_slave_info * s2_ths_init(void);
+s2_ths_t s2_ths_value_get(i2c_slave_info * info);
 
 /* 加速度&角速度传感器测量结果 */
 typedef struct 
@@ -37,10 +38,11 @@ typedef struct
 }s2_imu_t;
 
 /* 加速度&角速度传感器从机信息 */
-extern i2c_slave_info s2_imu_info;
+extern i2c_slave_info * s2_imu_info;
 
 /* 加速度&角速度传感器函数声明 */
-i2c_slave_info s2_imu_init(void);
-s2_imu_t s2_imu_value_get(i2c_slave_info info);
+i2c_slave_info * s2_imu_init(void);
+void s2_imu_value_prefetch(i2c_slave_info * info);
+s2_imu_t s2_imu_value_get(i2c_slave_info * info);
 
 #endif /* S2_H */
@@ -2,6 +2,7 @@
 #define S5_H
 
 #include "i2c.h"
+#include "delay.h"
 
 // MS523 CMD
 enum MS523_CMD
@@ -110,18 +111,23 @@ enum PICC_CMD
 #define MI_OK              0
 #define MI_NOTAGERR        1
 #define MI_ERR             2
+#define MI_YIELD           3 /* 被更高优先级的输入打断，未完成，不表示没有卡片，调用者下一轮重试 */
+
+/* 有更高优先级的输入等待处理时，收发命令至少轮询一次ComIrqReg并等待S5_NFC_YIELD_MIN_US后才让出，
+   覆盖寻卡、防冲突等短帧的卡片应答时间（106kbps下约1.2ms），连续按键时也能读到卡 */
+#define S5_NFC_YIELD_MIN_US 1500
 
 /* NFC从机信息 */
-extern i2c_slave_info s5_nfc_info;
+extern i2c_slave_info * s5_nfc_info;
 
 /* NFC函数声明 */
-i2c_slave_info s5_nfc_init(void);
-char s5_nfc_request(i2c_slave_info info, unsigned char RequestType, unsigned char *pCardType);
-char s5_nfc_anticoll(i2c_slave_info info, unsigned char *pCardID);
-char s5_nfc_select(i2c_slave_info info, unsigned char *pCardID);
-char s5_nfc_auth(i2c_slave_info info, unsigned char AuthMode, unsigned char addr, unsigned char *pKey, unsigned char *pCardID);
-char s5_nfc_read(i2c_slave_info info, unsigned char addr, unsigned char *pData);
-char s5_nfc_write(i2c_slave_info info, unsigned char addr, unsigned char *pData);
-char s5_nfc_halt(i2c_slave_info info);
+i2c_slave_info * s5_nfc_init(void);
+char s5_nfc_request(i2c_slave_info * info, unsigned char RequestType, unsigned char *pCardType);
+char s5_nfc_anticoll(i2c_slave_info * info, unsigned char *pCardID);
+char s5_nfc_select(i2c_slave_info * info, unsigned char *pCardID);
+char s5_nfc_auth(i2c_slave_info * info, unsigned char AuthMode, unsigned char addr, unsigned char *pKey, unsigned char *pCardID);
+char s5_nfc_read(i2c_slave_info * info, unsigned char addr, unsigned char *pData);
+char s5_nfc_write(i2c_slave_info * info, unsigned char addr, unsigned char *pData);
+char s5_nfc_halt(i2c_slave_info * info);
 
 #endif /* S5_H */
@@ -4,10 +4,11 @@
 #include "i2c.h"
 
 /* 人体红外传感器从机信息 */
-extern i2c_slave_info s7_ir_info;
+extern i2c_slave_info * s7_ir_info;
 
 /* 人体红外传感器函数声明 */
-i2c_slave_info s7_ir_init(void);
-unsigned char s7_ir_status_get(i2c_slave_info info);
+i2c_slave_info * s7_ir_init(void);
+void s7_ir_status_prefetch(i2c_slave_info * info);
+unsigned char s7_ir_status_get(i2c_slave_info * info);
 
 #endif /* S7_H */
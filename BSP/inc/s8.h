@@ -2,6 +2,7 @@
 #define S8_H
 
 #include "i2c.h"
+#include "delay.h"
 
 /* 温湿度传感器测量结果 */
 typedef struct
@@ -11,10 +12,10 @@ typedef struct
 }s8_ths_t;
 
 /* 温湿度传感器从机信息 */
-extern i2c_slave_info s8_ths_info;
+extern i2c_slave_info * s8_ths_info;
 
 /* 温湿度传感器函数声明 */
-i2c_slave_info s8_ths_init(void);
-s8_ths_t s8_ths_value_get(i2c_slave_info info);
+i2c_slave_info * s8_ths_init(void);
+s8_ths_t s8_ths_value_get(i2c_slave_info * info);
 
 #endif /* S8_H */
@@ -1,10 +1,9 @@
 #ifndef U1_H
 #define U1_H
 
+#ifndef BSP_HAL_SIM
 #include "gd32f4xx.h"
-
-/* 延时函数声明 */
-void u1_delay_ms(unsigned int ms);
+#endif
 
 /* LED函数声明 */
 void u1_led_init(void);
@@ -15,4 +14,8 @@ void u1_led_toggle(void);
 /* Timer函数声明 */
 void u1_timer0_init(void);
 
+/* 串口函数声明 */
+void u1_uart_init(unsigned int baudrate);
+void u1_uart_str_send(const char * str);
+
 #endif /* U1_H */
@@ -1,5 +1,187 @@
 #include "delay.h"
 
+#ifdef BSP_HAL_SIM
+#include <time.h>
+
+/* 上电时刻，PC上模拟运行时以CLOCK_MONOTONIC为时间基准 */
+static struct timespec delay_origin;
+/* 时间基准是否已初始化 */
+static volatile unsigned char delay_ready = 0;
+
+/*!
+	\功能       时间基准初始化，记录上电时刻
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void delay_init(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &delay_origin);
+	delay_ready = 1;
+}
+
+/*!
+	\功能       获取上电以来的纳秒数
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       纳秒数
+*/
+static unsigned long long delay_time_ns(void)
+{
+	struct timespec now;
+
+	if(!delay_ready)
+	{
+		delay_init();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - delay_origin.tv_sec) * 1000000000ULL + now.tv_nsec - delay_origin.tv_nsec;
+}
+
+/*!
+	\功能       获取上电以来的毫秒数
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       毫秒数，约49.7天回绕一次
+*/
+unsigned int delay_time_ms(void)
+{
+	return delay_time_ns() / 1000000;
+}
+
+/*!
+	\功能       获取上电以来的微秒数
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       微秒数，约71.6分钟回绕一次，差值运算不受回绕影响
+*/
+unsigned int delay_time_us(void)
+{
+	return delay_time_ns() / 1000;
+}
+#else
+/* SysTick中断计数，每1ms加1 */
+static volatile unsigned int delay_tick_ms = 0;
+/* 时间基准是否已初始化 */
+static volatile unsigned char delay_ready = 0;
+
+/*!
+	\功能       时间基准初始化，SysTick按系统主频每1ms中断一次
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void delay_init(void)
+{
+	/* 按SystemCoreClock计算重装载值，主频为168M/200M/240M时均为1ms */
+	SysTick_Config(SystemCoreClock / 1000);
+	delay_ready = 1;
+}
+
+/*!
+	\功能       SysTick中断服务程序
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void SysTick_Handler(void)
+{
+	delay_tick_ms ++;
+}
+
+/*!
+	\功能       获取上电以来的毫秒数
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       毫秒数，约49.7天回绕一次
+*/
+unsigned int delay_time_ms(void)
+{
+	if(!delay_ready)
+	{
+		delay_init();
+	}
+	return delay_tick_ms;
+}
+
+/*!
+	\功能       获取上电以来的微秒数
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       微秒数，约71.6分钟回绕一次，差值运算不受回绕影响
+*/
+unsigned int delay_time_us(void)
+{
+	unsigned int ms, val;
+	unsigned int load = SysTick->LOAD + 1;
+
+	if(!delay_ready)
+	{
+		delay_init();
+	}
+	do
+	{
+		ms = delay_tick_ms;
+		val = SysTick->VAL;
+		/* 计数器已重装载但中断尚未执行（在更高优先级中断中调用时），补上这1ms */
+		if((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && (val > load / 2))
+		{
+			ms ++;
+		}
+	}while(ms != delay_tick_ms);
+
+	/* SysTick为递减计数 */
+	return ms * 1000 + (load - 1 - val) * 1000 / load;
+}
+
+#endif /* BSP_HAL_SIM */
+
+/*!
+	\功能       计算从start开始经过的时间
+	\参数[输入] start: 起始时间（微秒），由delay_time_us获取
+	\参数[输出] 无
+	\返回       经过的微秒数
+*/
+unsigned int delay_elapsed_us(unsigned int start)
+{
+	return delay_time_us() - start;
+}
+
+/*!
+	\功能       计算从现在起经过us微秒的截止时间
+	\参数[输入] us: 时长（微秒），不超过35分钟
+	\参数[输出] 无
+	\返回       截止时间，用于delay_expired
+*/
+unsigned int delay_deadline(unsigned int us)
+{
+	return delay_time_us() + us;
+}
+
+/*!
+	\功能       判断截止时间是否已到
+	\参数[输入] deadline: 截止时间，由delay_deadline获取
+	\参数[输出] 无
+	\返回       1表示已到，0表示未到
+*/
+int delay_expired(unsigned int deadline)
+{
+	return (int)(delay_time_us() - deadline) >= 0;
+}
+
+/*!
+	\功能       延时
+	\参数[输入] us: 延时时间（微秒）
+	\参数[输出] 无
+	\返回       无
+*/
+void delay_us(unsigned int us)
+{
+	unsigned int start = delay_time_us();
+
+	while(delay_elapsed_us(start) < us);
+}
+
 /*!
 	\功能       延时
 	\参数[输入] ms: 延时时间（毫秒）
@@ -9,5 +191,7 @@
 void delay_ms(unsigned int ms)
 {
 	for(unsigned int i=0;i<ms;i++)
-		for(unsigned int j=0;j<40000;j++);
+	{
+		delay_us(1000);
+	}
 }
@@ -1,282 +1,425 @@
 #include "e1.h"
 
-i2c_slave_info e1_led_info;
+i2c_slave_info * e1_led_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char E1_PCA9685_ADDR[] = {0xC0, 0xC2, 0xC4, 0xC6};
-#else
-const static unsigned char E1_PCA9685_ADDR[] = {0x60, 0x61, 0x62, 0x63};
-#endif
+/* PCA9685的LED0~LED15 PWM寄存器（0x06~0x45）只由主机写入，使用影子缓存 */
+static i2c_shadow e1_pca9685_shadow;
+/* MODE1使能寄存器地址自动递增，相邻PWM寄存器的写入合并为一次突发写入 */
+static i2c_coalesce e1_pca9685_coalesce;
 
-static void e1_pca9685_init(i2c_slave_info info)
+static void e1_pca9685_init(i2c_slave_info * info)
 {
-	i2c_reg_byte_write(info, 0x00, 0x00);
+	i2c_shadow_attach(&e1_pca9685_shadow, info, 0x06, 64);
+	i2c_reg_byte_write(info, 0x00, 0x20);
+	i2c_coalesce_attach(&e1_pca9685_coalesce, info);
 }
 
-i2c_slave_info e1_led_init(void)
+i2c_slave_info * e1_led_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_E1_LED);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(E1_PCA9685_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], E1_PCA9685_ADDR[j]);
-			if(info.flag)
-			{
-				e1_pca9685_init(info);
-				return info;
-			}
-		}
+		e1_pca9685_init(info);
 	}
 	return info;
 }
 
-static void e1_pca9685_pwm_set(i2c_slave_info info, unsigned char num, unsigned short on, unsigned short off)
+static void e1_pca9685_pwm_set(i2c_slave_info * info, unsigned char num, unsigned short on, unsigned short off)
 {
-	i2c_reg_byte_write(info, 0x06+4*num, on);
-	i2c_reg_byte_write(info, 0x07+4*num, on>>8);
-	i2c_reg_byte_write(info, 0x08+4*num, off);
-	i2c_reg_byte_write(info, 0x09+4*num, off>>8);
+	unsigned char value[4] = {on, on>>8, off, off>>8};
+	/* 每个寄存器一段，经写合并缓冲合并为一次突发写入 */
+	i2c_seg segs[4] =
+	{
+		{0x06+4*num, &value[0], 1},
+		{0x07+4*num, &value[1], 1},
+		{0x08+4*num, &value[2], 1},
+		{0x09+4*num, &value[3], 1},
+	};
+
+	i2c_reg_segs_write(info, segs, 4);
 }
 
-void e1_led_rgb_set(i2c_slave_info info, unsigned char red, unsigned char green, unsigned char blue)
+void e1_led_rgb_set(i2c_slave_info * info, unsigned char red, unsigned char green, unsigned char blue)
 {	
 	unsigned short on, off;
 
-	on = 0x0f;
-	off = on + red*0x10;
-	e1_pca9685_pwm_set(info, 1, on, off);
-
+	/* 按通道顺序写入，三个通道的PWM寄存器（0x06~0x11）相邻，合并后一次发送 */
 	on = 0x0f;
 	off = on + green*0x10;
 	e1_pca9685_pwm_set(info, 0, on, off);
 
+	on = 0x0f;
+	off = on + red*0x10;
+	e1_pca9685_pwm_set(info, 1, on, off);
+
 	on = 0x0f;
 	off = on + blue*0x10;
 	e1_pca9685_pwm_set(info, 2, on, off);
+
+	i2c_coalesce_flush(info);
 }
 
 
-i2c_slave_info e1_tube_info;
+i2c_slave_info * e1_tube_info;
+
+/*
+	数码管段码：低字节写显示RAM的第一个字节，高字节写第二个字节
+	      A
+	    F   B
+	      G
+	    E   C
+	      D   DP
+*/
+#define E1_SEG_A   0x0008
+#define E1_SEG_B   0x0010
+#define E1_SEG_C   0x0020
+#define E1_SEG_D   0x0040
+#define E1_SEG_E   0x0080
+#define E1_SEG_F   0x0100
+#define E1_SEG_G   0x0200
+#define E1_SEG_DP  0x0400
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char E1_HT16K33_ADDR[] = {0xE0, 0xE2, 0xE4, 0xE6};
-#else
-const static unsigned char E1_HT16K33_ADDR[] = {0x70, 0x71, 0x72, 0x73};
-#endif
+/* 字母不区分大小写，大小写使用同一个字形 */
+#define E1_FONT_LETTER(c, seg)  [c] = (seg), [(c) - 'A' + 'a'] = (seg)
 
-const static unsigned char chr_code[][2] =
+/* 完整ASCII字形表，编译时生成，按字符直接查表；表中没有列出的字符（包括空格）显示为空白 */
+static const unsigned short e1_tube_font[128] =
 {
-	{0xF8, 0x01}, //0
-	{0x30, 0x00}, //1
-	{0xD8, 0x02}, //2
-	{0x78, 0x02}, //3
-	{0x30, 0x03}, //4
-	{0x68, 0x03}, //5
-	{0xE8, 0x03}, //6
-	{0x38, 0x00}, //7
-	{0xF8, 0x03}, //8
-	{0x78, 0x03}, //9
-	{0xB8, 0x03}, //A
-	{0xE0, 0x03}, //B
-	{0xC8, 0x01}, //C
-	{0xF0, 0x02}, //D
-	{0xC8, 0x03}, //E
-	{0x88, 0x03}, //F
-	{0xE8, 0x01}, //G
-	{0xB0, 0x03}, //H
-	{0x20, 0x00}, //I
-	{0x70, 0x00}, //J
-	{0xD0, 0x03}, //K
-	{0xC0, 0x01}, //L
-	{0xA8, 0x02}, //M
-	{0xA0, 0x02}, //N
-	{0xE0, 0x02}, //O
-	{0x98, 0x03}, //P
-	{0x38, 0x03}, //Q
-	{0x80, 0x02}, //R
-	{0x20, 0x03}, //S
-	{0xC0, 0x03}, //T
-	{0xF0, 0x01}, //U
-	{0x10, 0x03}, //V
-	{0x50, 0x03}, //W
-	{0xB0, 0x01}, //X
-	{0x70, 0x03}, //Y
-	{0x48, 0x02}, //Z
-	{0x00, 0x02}, //-
-	{0x00, 0x00}, //NULL
+	['0'] = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F,
+	['1'] = E1_SEG_B | E1_SEG_C,
+	['2'] = E1_SEG_A | E1_SEG_B | E1_SEG_D | E1_SEG_E | E1_SEG_G,
+	['3'] = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_G,
+	['4'] = E1_SEG_B | E1_SEG_C | E1_SEG_F | E1_SEG_G,
+	['5'] = E1_SEG_A | E1_SEG_C | E1_SEG_D | E1_SEG_F | E1_SEG_G,
+	['6'] = E1_SEG_A | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G,
+	['7'] = E1_SEG_A | E1_SEG_B | E1_SEG_C,
+	['8'] = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G,
+	['9'] = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_F | E1_SEG_G,
+	E1_FONT_LETTER('A', E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('B', E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('C', E1_SEG_A | E1_SEG_D | E1_SEG_E | E1_SEG_F),
+	E1_FONT_LETTER('D', E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_G),
+	E1_FONT_LETTER('E', E1_SEG_A | E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('F', E1_SEG_A | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('G', E1_SEG_A | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F),
+	E1_FONT_LETTER('H', E1_SEG_B | E1_SEG_C | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('I', E1_SEG_C),
+	E1_FONT_LETTER('J', E1_SEG_B | E1_SEG_C | E1_SEG_D),
+	E1_FONT_LETTER('K', E1_SEG_B | E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('L', E1_SEG_D | E1_SEG_E | E1_SEG_F),
+	E1_FONT_LETTER('M', E1_SEG_A | E1_SEG_C | E1_SEG_E | E1_SEG_G),
+	E1_FONT_LETTER('N', E1_SEG_C | E1_SEG_E | E1_SEG_G),
+	E1_FONT_LETTER('O', E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_G),
+	E1_FONT_LETTER('P', E1_SEG_A | E1_SEG_B | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('Q', E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('R', E1_SEG_E | E1_SEG_G),
+	E1_FONT_LETTER('S', E1_SEG_C | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('T', E1_SEG_D | E1_SEG_E | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('U', E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_E | E1_SEG_F),
+	E1_FONT_LETTER('V', E1_SEG_B | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('W', E1_SEG_B | E1_SEG_D | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('X', E1_SEG_B | E1_SEG_C | E1_SEG_E | E1_SEG_F),
+	E1_FONT_LETTER('Y', E1_SEG_B | E1_SEG_C | E1_SEG_D | E1_SEG_F | E1_SEG_G),
+	E1_FONT_LETTER('Z', E1_SEG_A | E1_SEG_D | E1_SEG_G),
+	['-']  = E1_SEG_G,
+	['_']  = E1_SEG_D,
+	['`']  = E1_SEG_A,
+	['\''] = E1_SEG_A,
+	['"']  = E1_SEG_B | E1_SEG_F,
+	['=']  = E1_SEG_D | E1_SEG_G,
+	['[']  = E1_SEG_A | E1_SEG_D | E1_SEG_E | E1_SEG_F,
+	['(']  = E1_SEG_A | E1_SEG_D | E1_SEG_E | E1_SEG_F,
+	[']']  = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D,
+	[')']  = E1_SEG_A | E1_SEG_B | E1_SEG_C | E1_SEG_D,
+	['?']  = E1_SEG_A | E1_SEG_B | E1_SEG_E | E1_SEG_G,
 };
 
-static void e1_ht16k33_init(i2c_slave_info info)
+/* HT16K33的显示RAM（0x00~0x0F）只由主机写入，使用影子缓存 */
+static i2c_shadow e1_ht16k33_shadow;
+/* 数码管显示RAM（0x02~0x09，每位两个字节）的本地映像：字符先渲染到映像中，刷新时一次突发写入 */
+#define E1_TUBE_RAM_FIRST  0x02
+static unsigned char e1_tube_ram[E1_TUBE_DIGITS * 2];
+/* 段码已改变、尚未发送的位，第n位表示第n+1位数码管 */
+static unsigned char e1_tube_dirty;
+/* 刷新统计 */
+static e1_tube_stat_t e1_tube_stat;
+/* 当前的闪烁方式和亮度：只在改变时发送命令，重新初始化时恢复 */
+static unsigned char e1_tube_blink = E1_TUBE_BLINK_OFF;
+static unsigned char e1_tube_bright = E1_TUBE_BRIGHT_MAX;
+
+/**
+ * @brief 把显示RAM映像中改变了的位发送到HT16K33：从第一个改变的位到最后一个改变的位作为一次突发写入，
+ *        地址自动递增；没有改变时不访问总线，发送失败时保留标记，下次刷新重发
+ * @param info  I2C从机信息
+ */
+static void e1_ht16k33_flush(i2c_slave_info * info)
 {
+	int first = 0;
+	int last = E1_TUBE_DIGITS - 1;
+
+	e1_tube_stat.flushes ++;
+	if(e1_tube_dirty == 0)
+	{
+		e1_tube_stat.unchanged ++;
+		return;
+	}
+	while(!(e1_tube_dirty & (1 << first)))
+	{
+		first ++;
+	}
+	while(!(e1_tube_dirty & (1 << last)))
+	{
+		last --;
+	}
+	if(i2c_reg_bytes_write(info, E1_TUBE_RAM_FIRST + first*2, &e1_tube_ram[first*2], (last - first + 1)*2))
+	{
+		e1_tube_dirty = 0;
+		e1_tube_stat.digits += last - first + 1;
+	}
+}
+
+static void e1_ht16k33_init(i2c_slave_info * info)
+{
+	i2c_shadow_attach(&e1_ht16k33_shadow, info, 0x00, 16);
 	i2c_byte_write(info, 0x21);
-	i2c_reg_byte_write(info, 0x02, 0x00);
-	i2c_reg_byte_write(info, 0x03, 0x00);
-	i2c_reg_byte_write(info, 0x04, 0x00);
-	i2c_reg_byte_write(info, 0x05, 0x00);
-	i2c_reg_byte_write(info, 0x06, 0x00);
-	i2c_reg_byte_write(info, 0x07, 0x00);
-	i2c_reg_byte_write(info, 0x08, 0x00);
-	i2c_reg_byte_write(info, 0x09, 0x00);
-	i2c_byte_write(info, 0x81);
+	for(int i=0; i<sizeof(e1_tube_ram); i++)
+	{
+		e1_tube_ram[i] = 0x00;
+	}
+	// 上电后显示RAM的内容未知，全部发送
+	e1_tube_dirty = (1 << E1_TUBE_DIGITS) - 1;
+	e1_ht16k33_flush(info);
+	// 显示只在初始化时开启一次，闪烁方式和亮度按当前设置恢复
+	i2c_byte_write(info, 0x81 | (e1_tube_blink << 1));
+	i2c_byte_write(info, 0xE0 | e1_tube_bright);
 }
 
-i2c_slave_info e1_tube_init(void)
+i2c_slave_info * e1_tube_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_E1_TUBE);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(E1_HT16K33_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], E1_HT16K33_ADDR[j]);
-			if(info.flag)
-			{
-				e1_ht16k33_init(info);
-				return info;
-			}
-		}
+		e1_ht16k33_init(info);
 	}
 	return info;
 }
 
 /**
- * @brief 直接设置单个数字的原始段码
- * @param info  I2C从机信息
- * @param bit   要设置的位数 (1-4)
+ * @brief 直接设置单个数字的原始段码，只修改显示RAM映像
+ * @param bit   要设置的位数 (1-4)，超出范围时忽略
  * @param seg1  段码数据字节1
  * @param seg2  段码数据字节2
  */
-static void e1_ht16k33_raw_set(i2c_slave_info info, unsigned char bit, unsigned char seg1, unsigned char seg2)
+static void e1_ht16k33_raw_set(unsigned char bit, unsigned char seg1, unsigned char seg2)
 {
-	// 根据位数选择正确的寄存器地址并写入数据
-	switch(bit)
+	if((bit < 1) || (bit > E1_TUBE_DIGITS))
+	{
+		return;
+	}
+	if((e1_tube_ram[(bit-1)*2] != seg1) || (e1_tube_ram[(bit-1)*2 + 1] != seg2))
 	{
-		case  1:
-			i2c_reg_byte_write(info, 0x02, seg1);
-			i2c_reg_byte_write(info, 0x03, seg2);
-			break;
-
-		case  2:
-			i2c_reg_byte_write(info, 0x04, seg1);
-			i2c_reg_byte_write(info, 0x05, seg2);
-			break;
-
-		case 3:
-			i2c_reg_byte_write(info, 0x06, seg1);
-			i2c_reg_byte_write(info, 0x07, seg2);
-			break;
-
-		case 4:
-			i2c_reg_byte_write(info, 0x08, seg1);
-			i2c_reg_byte_write(info, 0x09, seg2);
-			break;
-
-		default:
-			// 对于无效的位数，可以清空该位
-			i2c_reg_byte_write(info, 0x02 + (bit-1)*2, 0x00);
-			i2c_reg_byte_write(info, 0x03 + (bit-1)*2, 0x00);
-			break;
+		e1_tube_ram[(bit-1)*2] = seg1;
+		e1_tube_ram[(bit-1)*2 + 1] = seg2;
+		e1_tube_dirty |= 1 << (bit-1);
 	}
-	// 命令HT16K33开启显示
-	i2c_byte_write(info, 0x81);
 }
 
-static void e1_ht16k33_chr_set(i2c_slave_info info, unsigned char bit, unsigned char chr, unsigned char point)
+/**
+ * @brief 查字形表得到字符的段码
+ * @param chr  ASCII字符，超出字形表的字符显示为空白
+ * @return 段码，E1_SEG_x的组合
+ */
+static unsigned short e1_tube_seg_get(unsigned char chr)
+{
+	return (chr < 128) ? e1_tube_font[chr] : 0;
+}
+
+/**
+ * @brief 按段码设置单个数字，只修改显示RAM映像
+ * @param bit  要设置的位数 (1-4)
+ * @param seg  段码，E1_SEG_x的组合
+ */
+static void e1_ht16k33_seg_set(unsigned char bit, unsigned short seg)
+{
+	e1_ht16k33_raw_set(bit, seg & 0xFF, seg >> 8);
+}
+
+/* 滚动显示的段码序列（文字加末尾空白）、当前最左一位在序列中的位置和下一步的时间；长度为0表示没有滚动 */
+static char e1_scroll_text[E1_TUBE_SCROLL_LEN + 1];
+static unsigned short e1_scroll_seg[E1_TUBE_SCROLL_LEN + E1_TUBE_SCROLL_GAP];
+static unsigned char e1_scroll_len;
+static unsigned char e1_scroll_pos;
+static unsigned int e1_scroll_due;
+
+/**
+ * @brief 右对齐显示字符串：每个字符占一位，紧跟的'.'并入前一位的小数点，
+ *        不足四位时左侧补空白，超过四位时只显示最后四位；正在滚动的文字被替换
+ * @param info  I2C从机信息
+ * @param str   要显示的字符串
+ */
+void e1_tube_str_set(i2c_slave_info * info, char * str)
 {
-	unsigned char temp[2] = {chr_code[chr][0], chr_code[chr][1]};
+	const char * pstr = str + strlen(str);
+	unsigned short seg;
 
-	if(point)
+	e1_scroll_len = 0;
+	for(int i=E1_TUBE_DIGITS; i>=1; i--)
 	{
-		temp[1] += 0x04;
+		seg = 0;
+		if((pstr > str) && (*(pstr-1) == '.'))
+		{
+			seg = E1_SEG_DP;
+			pstr --;
+		}
+		if((pstr > str) && (*(pstr-1) != '.'))
+		{
+			pstr --;
+			seg |= e1_tube_seg_get(*pstr);
+		}
+		e1_ht16k33_seg_set(i, seg);
 	}
-	
-	switch(bit)
+	// 四位一起发送，一次传输
+	e1_ht16k33_flush(info);
+}
+
+/**
+ * @brief 把滚动序列中从当前位置开始的四位渲染到映像中，一次刷新
+ * @param info  I2C从机信息
+ */
+static void e1_tube_scroll_render(i2c_slave_info * info)
+{
+	unsigned char pos = e1_scroll_pos;
+
+	for(int i=1; i<=E1_TUBE_DIGITS; i++)
 	{
-		case  1:
-			i2c_reg_byte_write(info, 0x02, temp[0]);
-			i2c_reg_byte_write(info, 0x03, temp[1]);
-			break;
-
-		case  2:
-			i2c_reg_byte_write(info, 0x04, temp[0]);
-			i2c_reg_byte_write(info, 0x05, temp[1]);
-			break;
-
-		case 3:
-			i2c_reg_byte_write(info, 0x06, temp[0]);
-			i2c_reg_byte_write(info, 0x07, temp[1]);
-			break;
-
-		case 4:
-			i2c_reg_byte_write(info, 0x08, temp[0]);
-			i2c_reg_byte_write(info, 0x09, temp[1]);
-			break;
-
-		default:
-			break;
+		e1_ht16k33_seg_set(i, e1_scroll_seg[pos]);
+		pos = (pos + 1 < e1_scroll_len) ? pos + 1 : 0;
 	}
-	i2c_byte_write(info, 0x81);
+	e1_ht16k33_flush(info);
 }
 
-void e1_tube_str_set(i2c_slave_info info, char * str)
+/**
+ * @brief 滚动显示字符串：不超过四位时与e1_tube_str_set相同；超过四位时先显示前四位，
+ *        之后由e1_tube_scroll_poll按E1_TUBE_SCROLL_MS逐位左移，循环显示。
+ *        与正在滚动的文字相同时保持当前位置，可以每秒重复调用
+ * @param info  I2C从机信息
+ * @param str   要显示的字符串，超过E1_TUBE_SCROLL_LEN的部分不显示
+ */
+void e1_tube_scroll_start(i2c_slave_info * info, const char * str)
 {
-	char * pstr = str + strlen((char *)str) - 1;
+	unsigned char len = 0;
 
-	for(int i=4; i>=1; i--)
+	if(e1_scroll_len && (strncmp(e1_scroll_text, str, E1_TUBE_SCROLL_LEN) == 0))
 	{
-		if(pstr >= str)
+		return;
+	}
+	// 先按字形表转换成段码，'.'并入前一位的小数点
+	for(const char * pstr = str; *pstr && (pstr < str + E1_TUBE_SCROLL_LEN); pstr++)
+	{
+		if((*pstr == '.') && len && !(e1_scroll_seg[len-1] & E1_SEG_DP))
 		{
-			if(*pstr >= '0' && *pstr <= '9')
-			{
-				if(*(pstr+1) == '.')
-				{
-					e1_ht16k33_chr_set(info, i, *pstr-48, 1);
-				}
-				else
-				{
-					e1_ht16k33_chr_set(info, i, *pstr-48, 0);
-				}
-			}
-			else if(*pstr >= 'a' && *pstr <= 'z')
-			{
-				e1_ht16k33_chr_set(info, i, *pstr-97+10, 0);
-			}
-			else if(*pstr >= 'A' && *pstr <= 'Z')
-			{
-				e1_ht16k33_chr_set(info, i, *pstr-65+10, 0);
-			}
-            // --- 从这里开始是修改和添加的代码 ---
-			else if(*pstr == '-')
-			{
-                // 中横杠 (g segment)
-				e1_ht16k33_raw_set(info, i, 0x00, 0x02);
-			}
-            else if(*pstr == '_')
-            {
-                // 下横杠 (d segment)
-                e1_ht16k33_raw_set(info, i, 0x40, 0x00);
-            }
-            else if(*pstr == '`' || *pstr == '\'') // ` 或 ' 符号
-            {
-                // 上横杠 (a segment)
-                e1_ht16k33_raw_set(info, i, 0x80, 0x00);
-            }
-            // --- 修改和添加的代码到此结束 ---
-			else
-			{
-                // 如果是空格或其他无法识别的字符，跳过，不移动显示位置
-				i ++;
-			}
-			pstr --;
+			e1_scroll_seg[len-1] |= E1_SEG_DP;
 		}
 		else
 		{
-            // 如果字符串处理完了，用空字符填充剩余位置
-			e1_ht16k33_chr_set(info, i, 10+26+1, 0); // 10+26+1 是 NULL
+			e1_scroll_seg[len++] = (*pstr == '.') ? E1_SEG_DP : e1_tube_seg_get(*pstr);
 		}
 	}
-}
\ No newline at end of file
+	if(len <= E1_TUBE_DIGITS)
+	{
+		e1_tube_str_set(info, (char *)str);
+		return;
+	}
+	for(int i=0; i<E1_TUBE_SCROLL_GAP; i++)
+	{
+		e1_scroll_seg[len++] = 0;
+	}
+	strncpy(e1_scroll_text, str, E1_TUBE_SCROLL_LEN);
+	e1_scroll_len = len;
+	e1_scroll_pos = 0;
+	e1_scroll_due = delay_deadline(E1_TUBE_SCROLL_MS * 1000);
+	e1_tube_scroll_render(info);
+}
+
+/**
+ * @brief 停止滚动，数码管保持当前内容
+ */
+void e1_tube_scroll_stop(void)
+{
+	e1_scroll_len = 0;
+}
+
+/**
+ * @brief 在主循环中调用：到时间时滚动一位并刷新，不等待
+ * @param info  I2C从机信息
+ * @return 1: 滚动了一位, 0: 没有滚动或未到时间
+ */
+int e1_tube_scroll_poll(i2c_slave_info * info)
+{
+	if((e1_scroll_len == 0) || !delay_expired(e1_scroll_due))
+	{
+		return 0;
+	}
+	// 从现在开始计下一步，主循环被耽误时不连续补步
+	e1_scroll_due = delay_deadline(E1_TUBE_SCROLL_MS * 1000);
+	e1_scroll_pos = (e1_scroll_pos + 1 < e1_scroll_len) ? e1_scroll_pos + 1 : 0;
+	e1_tube_scroll_render(info);
+	return 1;
+}
+
+/**
+ * @brief 设置数码管硬件闪烁，由HT16K33自己闪烁，之后不需要主机刷新；与当前设置相同时不访问总线
+ * @param info   I2C从机信息
+ * @param blink  闪烁方式，E1_TUBE_BLINK_x
+ * @return 1: 成功, 0: 参数错误或发送失败，失败时下次调用重发
+ */
+int e1_tube_blink_set(i2c_slave_info * info, unsigned char blink)
+{
+	if(blink > E1_TUBE_BLINK_HALF_HZ)
+	{
+		return 0;
+	}
+	if(blink == e1_tube_blink)
+	{
+		return 1;
+	}
+	if(!i2c_byte_write(info, 0x81 | (blink << 1)))
+	{
+		return 0;
+	}
+	e1_tube_blink = blink;
+	return 1;
+}
+
+/**
+ * @brief 设置数码管亮度，由HT16K33调节占空比；与当前设置相同时不访问总线
+ * @param info   I2C从机信息
+ * @param level  亮度等级 (0-15)
+ * @return 1: 成功, 0: 参数错误或发送失败，失败时下次调用重发
+ */
+int e1_tube_bright_set(i2c_slave_info * info, unsigned char level)
+{
+	if(level > E1_TUBE_BRIGHT_MAX)
+	{
+		return 0;
+	}
+	if(level == e1_tube_bright)
+	{
+		return 1;
+	}
+	if(!i2c_byte_write(info, 0xE0 | level))
+	{
+		return 0;
+	}
+	e1_tube_bright = level;
+	return 1;
+}
+
+void e1_tube_stat_get(e1_tube_stat_t * stat)
+{
+	*stat = e1_tube_stat;
+}
@@ -1,47 +1,47 @@
 #include "e2.h"
 
-i2c_slave_info e2_fan_info;
+i2c_slave_info * e2_fan_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char E2_PCA9685_ADDR[] = {0xC8, 0xCA, 0xCC, 0xCE};
-#else
-const static unsigned char E2_PCA9685_ADDR[] = {0x64, 0x65, 0x66, 0x67};
-#endif
+/* PCA9685的LED0~LED15 PWM寄存器（0x06~0x45）只由主机写入，使用影子缓存 */
+static i2c_shadow e2_pca9685_shadow;
+/* MODE1使能寄存器地址自动递增，相邻PWM寄存器的写入合并为一次突发写入 */
+static i2c_coalesce e2_pca9685_coalesce;
 
-static void e2_pca9685_init(i2c_slave_info info)
+static void e2_pca9685_init(i2c_slave_info * info)
 {
-	i2c_reg_byte_write(info, 0x00, 0x00);
+	i2c_shadow_attach(&e2_pca9685_shadow, info, 0x06, 64);
+	i2c_reg_byte_write(info, 0x00, 0x20);
+	i2c_coalesce_attach(&e2_pca9685_coalesce, info);
 }
 
-i2c_slave_info e2_fan_init(void)
+i2c_slave_info * e2_fan_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_E2_FAN);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(E2_PCA9685_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], E2_PCA9685_ADDR[j]);
-			if(info.flag)
-			{
-				e2_pca9685_init(info);
-				return info;
-			}
-		}
+		e2_pca9685_init(info);
 	}
 	return info;
 }
 
-static void e2_pca9685_pwm_set(i2c_slave_info info, unsigned char num, unsigned short on, unsigned short off)
+static void e2_pca9685_pwm_set(i2c_slave_info * info, unsigned char num, unsigned short on, unsigned short off)
 {
-	i2c_reg_byte_write(info, 0x06+4*num, on);
-	i2c_reg_byte_write(info, 0x07+4*num, on>>8);
-	i2c_reg_byte_write(info, 0x08+4*num, off);
-	i2c_reg_byte_write(info, 0x09+4*num, off>>8);
+	unsigned char value[4] = {on, on>>8, off, off>>8};
+	/* 每个寄存器一段，经写合并缓冲合并为一次突发写入 */
+	i2c_seg segs[4] =
+	{
+		{0x06+4*num, &value[0], 1},
+		{0x07+4*num, &value[1], 1},
+		{0x08+4*num, &value[2], 1},
+		{0x09+4*num, &value[3], 1},
+	};
+
+	i2c_reg_segs_write(info, segs, 4);
 }
 
-void e2_fan_speed_set(i2c_slave_info info, unsigned char speed)
+void e2_fan_speed_set(i2c_slave_info * info, unsigned char speed)
 {	
 	unsigned short on, off;
 
@@ -52,4 +52,5 @@ void e2_fan_speed_set(i2c_slave_info info, unsigned char speed)
 	on = 0x00;
 	off = on + 0xfff*speed/100;
 	e2_pca9685_pwm_set(info, 0, on, off);
+	i2c_coalesce_flush(info);
 }
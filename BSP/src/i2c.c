@@ -1,178 +1,1436 @@
-#include "i2c.h"
+#include "i2c_hal.h"
+
+/* I2C从机时序表，下标为I2C_TIMING_x */
+static const i2c_timing I2C_TIMING_TAB[] =
+{
+	{.gap = 0,    .hold = 0}, /* I2C_TIMING_NONE */
+	{.gap = 2000, .hold = 0}, /* I2C_TIMING_GD32 */
+};
+
+/* I2C模块描述，由I2C_DEV_LIST生成 */
+typedef struct
+{
+	const char * name;                    /* 模块名，用于总线分配报告 */
+	unsigned int speed;                   /* 从机支持的最高时钟速度 */
+	unsigned char timing;                 /* 时序类型 */
+	unsigned char prio;                   /* 传输优先级 */
+	unsigned char addr[I2C_DEV_ADDR_MAX]; /* 候选地址（7位） */
+	unsigned char addr_num;               /* 候选地址个数 */
+}i2c_dev_desc;
+
+#define I2C_DEV_DESC(id, name, speed, timing, prio, ...) \
+	{name, speed, timing, prio, {__VA_ARGS__}, sizeof((unsigned char[]){__VA_ARGS__})},
+#define I2C_DEV_ADDR_COUNT(id, name, speed, timing, prio, ...) + sizeof((unsigned char[]){__VA_ARGS__})
+
+/* I2C模块表，下标为I2C_DEV_x；总线扫描时在每个接口上逐一探测所有候选地址 */
+static const i2c_dev_desc I2C_DEV_TAB[I2C_DEV_NUM] =
+{
+	I2C_DEV_LIST(I2C_DEV_DESC)
+};
+
+/* 所有模块的候选地址总数 */
+enum { I2C_DEV_ADDR_TOTAL = 0 I2C_DEV_LIST(I2C_DEV_ADDR_COUNT) };
+
+/* 模块的第n个候选地址，按本平台的地址格式 */
+#define I2C_DEV_ADDR(dev, n) ((unsigned char)((dev)->addr[n] << I2C_ADDR_SHIFT))
+
+/* 从机注册表，每个接口一个256位的地址位图，置1表示该地址的从机存在 */
+static unsigned char i2c_registry[sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)][32];
+/* 每个模块的从机槽位，扫描后和驱动查找时按注册表填写，下标为I2C_DEV_x；驱动持有槽位的指针，槽位不移动 */
+static i2c_slave_info i2c_dev_slot[I2C_DEV_NUM];
+/* 总线是否已扫描 */
+static unsigned char i2c_scanned = 0;
+/* 重新探测的位置（接口、模块表的下标和候选地址的下标）和上一次探测的时间（毫秒） */
+static unsigned char i2c_rescan_periph = 0;
+static unsigned char i2c_rescan_dev = 0;
+static unsigned char i2c_rescan_addr = 0;
+static unsigned int i2c_rescan_time = 0;
+
+/* I2C总线扫描统计 */
+i2c_scan_stat_t i2c_scan_stat;
+
+/* 周期传输链表 */
+static i2c_periodic * i2c_periodic_list = 0;
+/* 让出请求的位图，第n位表示优先级为n的输入等待处理 */
+static volatile unsigned char i2c_yield_mask = 0;
+
+#if I2C_TRACE_ENABLE
+/* 传输跟踪环形缓冲区，i2c_trace_total为已记录的总次数 */
+static i2c_trace_entry i2c_trace_buf[I2C_TRACE_DEPTH];
+static unsigned int i2c_trace_total = 0;
+/* 从机传输统计表 */
+static i2c_trace_dev i2c_trace_dev_tab[I2C_TRACE_DEV_MAX];
+static unsigned int i2c_trace_dev_num = 0;
+#endif
+
+/* I2C总线阶段 */
+#define I2C_PHASE_IDLE     0 /* 空闲 */
+#define I2C_PHASE_ACTIVE   1 /* 后端正在线上传输 */
+#define I2C_PHASE_GAP      2 /* 寄存器地址已发送，等待间隔结束 */
+#define I2C_PHASE_HOLD     3 /* 写操作已完成，等待从机保持时间结束 */
+#define I2C_PHASE_BUSY     4 /* 等待总线空闲后发送起始信号 */
+
+/* I2C总线状态 */
+typedef struct
+{
+	unsigned int periph;          /* I2C接口 */
+	i2c_xfer * head;              /* 队首，即正在进行的传输 */
+	i2c_xfer * tail;              /* 队尾 */
+	volatile unsigned char phase; /* 总线阶段 */
+	unsigned int wait_end;        /* 间隔或保持时间的截止时间（微秒） */
+	unsigned int deadline;        /* 队首传输的超时时间（微秒） */
+	unsigned int xfer_start;      /* 队首传输的启动时间（微秒），用于传输跟踪和占用时间统计 */
+	unsigned int busy_us;         /* 累计的总线占用时间（微秒），从传输启动到结束 */
+	unsigned int speed;           /* 当前时钟速度 */
+	unsigned int speed_max;       /* 总线上所有从机都支持的最高时钟速度 */
+	unsigned short error_count;   /* 当前统计窗口内的总线错误次数 */
+	unsigned short xfer_count;    /* 当前统计窗口内的传输次数 */
+}i2c_bus;
+
+/* I2C总线状态表，与I2C_PERIPH_NUM一一对应 */
+static i2c_bus i2c_bus_tab[] =
+{
+	{.periph = I2C0, .speed = I2C0_SPEED},
+	{.periph = I2C1, .speed = I2C1_SPEED},
+};
+
+/*!
+	\功能       查找I2C接口对应的总线状态
+	\参数[输入] periph: I2C接口
+	\参数[输出] 无
+	\返回       总线状态，接口无效时返回NULL
+*/
+static i2c_bus * i2c_bus_get(unsigned int periph)
+{
+	for(int i=0; i<sizeof(i2c_bus_tab)/sizeof(i2c_bus); i++)
+	{
+		if(i2c_bus_tab[i].periph == periph)
+		{
+			return &i2c_bus_tab[i];
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       重新配置总线时钟速度，只能在总线空闲时调用
+	\参数[输入] bus  : 总线状态
+	\参数[输入] speed: 时钟速度
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_speed_config(i2c_bus * bus, unsigned int speed)
+{
+	i2c_hal_speed_set(bus - i2c_bus_tab, speed);
+	bus->speed = speed;
+	bus->error_count = 0;
+	bus->xfer_count = 0;
+}
+
+/*!
+	\功能       每次传输结束时检查总线错误次数，错误过多时降低时钟速度
+	\参数[输入] bus: 总线状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_speed_check(i2c_bus * bus)
+{
+	bus->xfer_count ++;
+	if((bus->error_count >= I2C_SPEED_ERROR_LIMIT) && (bus->speed > I2C_SPEED_STD))
+	{
+		/* 在下一次启动传输时降速，此时总线空闲 */
+		bus->speed_max = (bus->speed / 2 > I2C_SPEED_STD) ? bus->speed / 2 : I2C_SPEED_STD;
+	}
+	else if(bus->xfer_count >= I2C_SPEED_ERROR_WINDOW)
+	{
+		bus->error_count = 0;
+		bus->xfer_count = 0;
+	}
+}
+
+/*!
+	\功能       总线空闲时启动队首传输，总线仍忙时保持I2C_PHASE_BUSY，由i2c_xfer_poll重试
+	\参数[输入] bus: 总线状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_launch(i2c_bus * bus)
+{
+	unsigned char index = bus - i2c_bus_tab;
+	unsigned int start = delay_time_us();
+
+	/* 等待I2C总线变为空闲状态，即上一次传输的停止信号发送完成，通常只需几微秒 */
+	while(i2c_hal_busy(index))
+	{
+		if(delay_elapsed_us(start) >= I2C_BUSY_SPIN_US)
+		{
+			/* 等待期间关闭后端的中断 */
+			i2c_hal_stop(index);
+			return;
+		}
+	}
+
+	bus->phase = I2C_PHASE_ACTIVE;
+	if(bus->speed_max && (bus->speed != bus->speed_max))
+	{
+		/* 总线扫描后协商的速度或错误过多后的降速 */
+		i2c_bus_speed_config(bus, bus->speed_max);
+	}
+	/* 向I2C总线上发送起始信号，后续由后端推进 */
+	i2c_hal_start(index, bus->head);
+}
+
+/*!
+	\功能       计算传输的数据总数，包括向量写的后续段
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       数据个数
+*/
+static unsigned int i2c_xfer_bytes(i2c_xfer * xfer)
+{
+	unsigned int count = xfer->count;
+
+	for(int i=0; i<xfer->seg_num; i++)
+	{
+		count += xfer->segs[i].count;
+	}
+	return count;
+}
+
+/*!
+	\功能       启动队首传输
+	\参数[输入] bus: 总线状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_start(i2c_bus * bus)
+{
+	i2c_xfer * xfer = bus->head;
+	unsigned int segs = xfer->seg_num + 1;
+	/* 按标准模式估算线上时间：每字节9个时钟，每段另加地址、重复起始和停止的开销 */
+	unsigned int budget = (i2c_xfer_bytes(xfer) + 4 * segs) * 9 * 1000000 / I2C_SPEED_STD;
+
+	bus->phase = I2C_PHASE_BUSY;
+	bus->deadline = delay_deadline(budget + xfer->gap * segs + I2C_TIMEOUT_US);
+	bus->xfer_start = delay_time_us();
+
+	i2c_bus_launch(bus);
+}
+
+#if I2C_TRACE_ENABLE
+/*!
+	\功能       记录一次传输到跟踪缓冲区和从机统计，在传输结束时调用
+	\参数[输入] bus   : 总线状态
+	\参数[输入] xfer  : 结束的传输
+	\参数[输入] status: 传输状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_trace_record(i2c_bus * bus, i2c_xfer * xfer, unsigned char status)
+{
+	unsigned int duration = delay_elapsed_us(bus->xfer_start);
+	unsigned char index = bus - i2c_bus_tab;
+	i2c_trace_entry * entry = &i2c_trace_buf[i2c_trace_total % I2C_TRACE_DEPTH];
+	i2c_trace_dev * dev = 0;
+	int bucket = 0;
+
+	entry->time = bus->xfer_start;
+	entry->duration = duration;
+	entry->bus = index;
+	entry->addr = xfer->addr;
+	entry->reg = xfer->reg;
+	entry->flags = xfer->flags;
+	entry->count = i2c_xfer_bytes(xfer);
+	entry->status = status;
+	i2c_trace_total ++;
+
+	for(int i=0; i<i2c_trace_dev_num; i++)
+	{
+		if((i2c_trace_dev_tab[i].bus == index) && (i2c_trace_dev_tab[i].addr == xfer->addr))
+		{
+			dev = &i2c_trace_dev_tab[i];
+			break;
+		}
+	}
+	if(dev == 0)
+	{
+		/* 探测不存在的地址不占用统计表，否则扫描后表被占满，真正工作的从机不被统计 */
+		if((i2c_trace_dev_num >= I2C_TRACE_DEV_MAX) || (status == I2C_XFER_NACK))
+		{
+			return;
+		}
+		dev = &i2c_trace_dev_tab[i2c_trace_dev_num++];
+		dev->bus = index;
+		dev->addr = xfer->addr;
+	}
+
+	dev->calls ++;
+	dev->errors += (status != I2C_XFER_DONE);
+	dev->bytes += entry->count;
+	dev->total_us += duration;
+	if(duration > dev->max_us)
+	{
+		dev->max_us = duration;
+	}
+	while((bucket < I2C_TRACE_BUCKETS - 1) && (duration >> (bucket + 1)))
+	{
+		bucket ++;
+	}
+	dev->hist[bucket] ++;
+}
+#endif
+
+/*!
+	\功能       按传输结果更新从机的健康统计，已找到的从机连续非应答或超时达到I2C_DETACH_LIMIT次时判定为已拔出
+	\参数[输入] slave : 从机信息
+	\参数[输入] index : 接口序号
+	\参数[输入] status: 传输状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_slave_track(i2c_slave_info * slave, unsigned char index, unsigned char status)
+{
+	slave->health.xfers ++;
+	if(status == I2C_XFER_DONE)
+	{
+		slave->fail_run = 0;
+		return;
+	}
+	if(status == I2C_XFER_NACK)
+	{
+		slave->health.nack ++;
+	}
+	else if(status == I2C_XFER_TIMEOUT)
+	{
+		slave->health.timeout ++;
+	}
+	else
+	{
+		/* 仲裁丢失和总线错误是信号质量问题，不说明从机已拔出 */
+		slave->health.bus_error ++;
+		return;
+	}
+	if(slave->flag && (++slave->fail_run >= I2C_DETACH_LIMIT))
+	{
+		/* 之后的访问直接失败；注册表中清除后由i2c_bus_rescan重新探测，再次接入时驱动重新初始化 */
+		slave->flag = 0;
+		slave->fail_run = 0;
+		i2c_registry[index][slave->addr >> 3] &= ~(1 << (slave->addr & 0x07));
+		i2c_scan_stat.detach_count ++;
+	}
+}
+
+/*!
+	\功能       结束队首传输并启动下一个传输
+	\参数[输入] bus   : 总线状态
+	\参数[输入] status: 传输状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_finish(i2c_bus * bus, unsigned char status)
+{
+	i2c_xfer * xfer = bus->head;
+	i2c_xfer_callback callback = xfer->callback;
+	unsigned short hold = (xfer->flags & I2C_XFER_READ) ? 0 : xfer->hold;
+
+	i2c_bus_speed_check(bus);
+	bus->busy_us += delay_elapsed_us(bus->xfer_start);
+	i2c_slave_track(xfer->slave, bus - i2c_bus_tab, status);
+#if I2C_TRACE_ENABLE
+	i2c_trace_record(bus, xfer, status);
+#endif
+
+	/* 传输出队 */
+	bus->head = xfer->next;
+	if(bus->head == 0)
+	{
+		bus->tail = 0;
+	}
+	bus->phase = I2C_PHASE_IDLE;
+
+	/* 设置状态后传输描述可能被调用者立即重用，不再访问xfer的其他成员 */
+	xfer->status = status;
+	if(callback)
+	{
+		callback(xfer);
+	}
+
+	if(hold && (status == I2C_XFER_DONE))
+	{
+		/* 从机需要时间处理写入的数据，由i2c_xfer_poll在保持时间结束后启动下一个传输 */
+		bus->wait_end = delay_deadline(hold);
+		bus->phase = I2C_PHASE_HOLD;
+	}
+	if(bus->head && (bus->phase == I2C_PHASE_IDLE))
+	{
+		/* 启动下一个传输 */
+		i2c_bus_start(bus);
+	}
+	else
+	{
+		/* 队列为空或处于保持时间，关闭后端的中断 */
+		i2c_hal_stop(bus - i2c_bus_tab);
+	}
+}
+
+/*!
+	\功能       传输超时处理，恢复总线并结束队首传输，需在关中断时调用
+	\参数[输入] bus: 总线状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_bus_timeout(i2c_bus * bus)
+{
+	unsigned char index = bus - i2c_bus_tab;
+
+	/* 恢复时的软件复位清除了时钟配置，按当前速度重新配置；速度未变，保留降速统计 */
+	i2c_hal_recover(index);
+	i2c_hal_speed_set(index, bus->speed);
+	/* 总线挂死计入降速统计 */
+	bus->error_count ++;
+	i2c_bus_finish(bus, I2C_XFER_TIMEOUT);
+}
+
+/*!
+	\功能       后端通知寄存器地址已发送、SCL保持拉低，开始计时寄存器间隔，在I2C中断中调用
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_gap(unsigned char bus)
+{
+	i2c_bus * pbus = &i2c_bus_tab[bus];
+
+	/* 由i2c_xfer_poll在截止时间到达后结束间隔 */
+	pbus->wait_end = delay_deadline(pbus->head->gap);
+	pbus->phase = I2C_PHASE_GAP;
+}
+
+/*!
+	\功能       后端通知线上传输已结束（已发送停止信号或已失去总线），在I2C中断中调用
+	\参数[输入] bus   : 总线序号
+	\参数[输入] status: 传输状态
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_done(unsigned char bus, unsigned char status)
+{
+	i2c_bus * pbus = &i2c_bus_tab[bus];
+
+	if(pbus->head == 0)
+	{
+		return;
+	}
+	if((status == I2C_XFER_ARLO) || (status == I2C_XFER_BERR))
+	{
+		/* 单主机总线上的仲裁丢失和总线错误都是信号质量问题，计入降速统计；非应答是从机行为，不计入 */
+		pbus->error_count ++;
+	}
+	i2c_bus_finish(pbus, status);
+}
+
+/*!
+	\功能       I2C初始化（包括I2C0和I2C1），重复调用时直接返回
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_init(void)
+{
+	static unsigned char init_done = 0;
+
+	if(init_done)
+	{
+		return;
+	}
+	init_done = 1;
+
+	/* 接口、中断和DMA配置由后端完成 */
+	i2c_hal_init();
+	/* 延时1ms */
+	delay_ms(1);
+}
+
+/*!
+	\功能       初始化I2C传输描述
+	\参数[输入] info  : I2C从机信息
+	\参数[输入] flags : 传输标志，I2C_XFER_REG和I2C_XFER_READ的组合
+	\参数[输入] reg   : 寄存器的地址，flags不含I2C_XFER_REG时忽略
+	\参数[输入] pbytes: 数据缓冲区
+	\参数[输入] count : 数据个数
+	\参数[输出] xfer  : I2C传输描述
+	\返回       无
+*/
+void i2c_xfer_init(i2c_xfer * xfer, i2c_slave_info * info, unsigned char flags, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	xfer->periph = info->periph;
+	xfer->addr = info->addr;
+	xfer->flags = flags;
+	xfer->prio = info->prio;
+	xfer->reg = reg;
+	xfer->gap = I2C_TIMING_TAB[info->timing].gap;
+	xfer->hold = I2C_TIMING_TAB[info->timing].hold;
+	xfer->pbytes = pbytes;
+	xfer->count = count;
+	xfer->segs = 0;
+	xfer->seg_num = 0;
+	xfer->slave = info;
+	xfer->status = I2C_XFER_IDLE;
+	xfer->callback = 0;
+	xfer->arg = 0;
+	xfer->next = 0;
+}
+
+/*!
+	\功能       提交I2C传输，立即返回，传输在I2C中断中完成；排队时按优先级插入
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+int i2c_xfer_submit(i2c_xfer * xfer)
+{
+	i2c_bus * bus = i2c_bus_get(xfer->periph);
+	unsigned int primask;
+
+	if(bus == 0)
+	{
+		xfer->status = I2C_XFER_ERROR;
+		return 0;
+	}
+
+	xfer->next = 0;
+	xfer->status = I2C_XFER_PENDING;
+
+	/* 关中断，防止与I2C中断同时修改队列 */
+	primask = i2c_hal_irq_save();
+	if(bus->head == 0)
+	{
+		bus->head = xfer;
+		bus->tail = xfer;
+	}
+	else
+	{
+		/* 队首已启动或在等待保持时间，不参与排序；其后按优先级插到同一优先级的最后 */
+		i2c_xfer * prev = bus->head;
+
+		while(prev->next && (prev->next->prio <= xfer->prio))
+		{
+			prev = prev->next;
+		}
+		xfer->next = prev->next;
+		prev->next = xfer;
+		if(xfer->next == 0)
+		{
+			bus->tail = xfer;
+		}
+	}
+	if((bus->head == xfer) && (bus->phase == I2C_PHASE_IDLE))
+	{
+		/* 总线空闲，立即启动 */
+		i2c_bus_start(bus);
+	}
+	i2c_hal_irq_restore(primask);
+
+	return 1;
+}
+
+/*!
+	\功能       执行已完成的周期传输的回调，提交到期的周期传输
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_periodic_poll(void)
+{
+	for(i2c_periodic * periodic = i2c_periodic_list; periodic; periodic = periodic->next)
+	{
+		if(periodic->active)
+		{
+			if(periodic->xfer.status == I2C_XFER_PENDING)
+			{
+				continue;
+			}
+			/* 先清除标志，回调中的阻塞式传输会再次进入i2c_xfer_poll */
+			periodic->active = 0;
+			if(periodic->callback)
+			{
+				periodic->callback(periodic);
+			}
+		}
+		if(delay_expired(periodic->due))
+		{
+			periodic->due += periodic->period;
+			if(delay_expired(periodic->due))
+			{
+				/* 落后超过一个周期（如驱动中的delay_ms）时不补发，从现在开始计下一个周期 */
+				periodic->due = delay_deadline(periodic->period);
+			}
+			/* 已拔出的从机不提交，不占用总线 */
+			periodic->active = periodic->xfer.slave->flag && i2c_xfer_submit(&periodic->xfer);
+		}
+	}
+}
+
+/*!
+	\功能       结束已到期的寄存器间隔和保持时间，在总线空闲后启动等待中的传输，处理超时的传输，提交到期的周期传输，不阻塞
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_xfer_poll(void)
+{
+	unsigned int primask;
+
+	/* 中断驱动的后端无需处理，模拟后端在此推进线上传输 */
+	i2c_hal_poll();
+	for(int i=0; i<sizeof(i2c_bus_tab)/sizeof(i2c_bus); i++)
+	{
+		i2c_bus * bus = &i2c_bus_tab[i];
+
+		if(bus->phase == I2C_PHASE_IDLE)
+		{
+			continue;
+		}
+		if((bus->phase == I2C_PHASE_GAP) || (bus->phase == I2C_PHASE_HOLD))
+		{
+			if(!delay_expired(bus->wait_end))
+			{
+				continue;
+			}
+		}
+		else if((bus->phase != I2C_PHASE_BUSY) && !delay_expired(bus->deadline))
+		{
+			continue;
+		}
+
+		primask = i2c_hal_irq_save();
+		if((bus->phase != I2C_PHASE_IDLE) && (bus->phase != I2C_PHASE_HOLD) && delay_expired(bus->deadline))
+		{
+			/* 从机拉住总线或中断不再到来，恢复总线后以超时结束 */
+			i2c_bus_timeout(bus);
+		}
+		else if(bus->phase == I2C_PHASE_BUSY)
+		{
+			i2c_bus_launch(bus);
+		}
+		else if(bus->phase == I2C_PHASE_GAP)
+		{
+			/* 间隔结束，由后端继续发送数据 */
+			bus->phase = I2C_PHASE_ACTIVE;
+			i2c_hal_resume(i);
+		}
+		else if(bus->phase == I2C_PHASE_HOLD)
+		{
+			/* 保持时间结束，启动排队的传输 */
+			bus->phase = I2C_PHASE_IDLE;
+			if(bus->head)
+			{
+				i2c_bus_start(bus);
+			}
+		}
+		i2c_hal_irq_restore(primask);
+	}
+	i2c_periodic_poll();
+}
+
+/*!
+	\功能       等待I2C传输完成
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+int i2c_xfer_wait(i2c_xfer * xfer)
+{
+	while(xfer->status == I2C_XFER_PENDING)
+	{
+		i2c_xfer_poll();
+	}
+	return (xfer->status == I2C_XFER_DONE);
+}
+
+/*!
+	\功能       启动周期传输，已启动时只修改周期；之后每次i2c_xfer_poll检查是否到期，不必由主循环调用
+	\参数[输入] periodic: 周期传输，xfer、callback和arg由调用者设置
+	\参数[输入] period  : 周期（微秒）
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_periodic_start(i2c_periodic * periodic, unsigned int period)
+{
+	i2c_periodic * p = i2c_periodic_list;
+
+	periodic->period = period;
+	while(p && (p != periodic))
+	{
+		p = p->next;
+	}
+	if(p == 0)
+	{
+		periodic->active = 0;
+		periodic->due = delay_time_us();
+		periodic->next = i2c_periodic_list;
+		i2c_periodic_list = periodic;
+	}
+}
+
+/*!
+	\功能       请求优先级更低的长传输序列让出总线，由产生输入的驱动在检测到新输入时调用
+	\参数[输入] prio: 输入的优先级，I2C_PRIO_x
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_yield_request(unsigned char prio)
+{
+	i2c_yield_mask |= 1 << prio;
+}
+
+/*!
+	\功能       清除让出请求，由产生输入的驱动在输入被取走后调用
+	\参数[输入] prio: 输入的优先级，I2C_PRIO_x
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_yield_clear(unsigned char prio)
+{
+	i2c_yield_mask &= ~(1 << prio);
+}
+
+/*!
+	\功能       长传输序列在两次传输之间检查是否应让出：有更高优先级的输入等待处理时，
+	            序列应尽快结束并返回，由上层在下一轮重试
+	\参数[输入] prio: 序列的优先级，I2C_PRIO_x
+	\参数[输出] 无
+	\返回       1表示应让出，0表示继续
+*/
+int i2c_yield_check(unsigned char prio)
+{
+	/* 先推进周期传输，按键等输入在序列执行期间也能被采样到 */
+	i2c_xfer_poll();
+	return (i2c_yield_mask & ((1 << prio) - 1)) != 0;
+}
+
+/*!
+	\功能       提交已初始化的传输并等待完成，失败时按I2C_RETRY_MAX和I2C_RETRY_BACKOFF_US退避后重试
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+static int i2c_xfer_run(i2c_xfer * xfer)
+{
+	i2c_slave_info * info = xfer->slave;
+	unsigned int backoff = I2C_RETRY_BACKOFF_US;
+	unsigned int end;
+
+	for(int n=0; ; n++)
+	{
+		if(i2c_xfer_submit(xfer) && i2c_xfer_wait(xfer))
+		{
+			info->health.recovered += (n != 0);
+			return 1;
+		}
+		if((n >= I2C_RETRY_MAX) || !info->flag)
+		{
+			/* 重试用尽或从机已判定为拔出 */
+			info->health.failed ++;
+			return 0;
+		}
+		/* 退避，给从机时间从忙碌或干扰中恢复，等待期间推进其他总线上的传输 */
+		end = delay_deadline(backoff);
+		while(!delay_expired(end))
+		{
+			i2c_xfer_poll();
+		}
+		backoff <<= 1;
+		info->health.retry ++;
+	}
+}
+
+/*!
+	\功能       提交I2C传输并等待完成，供阻塞式接口使用
+	\参数[输入] info  : I2C从机信息
+	\参数[输入] flags : 传输标志
+	\参数[输入] reg   : 寄存器的地址
+	\参数[输入] pbytes: 数据缓冲区
+	\参数[输入] count : 数据个数
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+static int i2c_xfer_sync(i2c_slave_info * info, unsigned char flags, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	i2c_xfer xfer;
+
+	if(!info->flag)
+	{
+		/* 未检测到的从机直接返回失败，不占用总线 */
+		return 0;
+	}
+	i2c_xfer_init(&xfer, info, flags, reg, pbytes, count);
+	return i2c_xfer_run(&xfer);
+}
+
+/*!
+	\功能       I2C从机检测
+	\参数[输入] periph: I2C从机接口，I2Cx(x=0,1,2)
+	\参数[输入] addr  : I2C从机地址
+	\参数[输出] 无
+	\返回       I2C从机信息
+*/
+i2c_slave_info i2c_slave_detect(unsigned int periph, unsigned char addr)
+{
+	/* I2C从机信息 */
+	i2c_slave_info info =
+	{
+		.periph = periph,
+		.addr = addr,
+		.flag = 0,
+		.timing = I2C_TIMING_NONE,
+		.prio = I2C_PRIO_SENSOR,
+	};
+	i2c_xfer xfer;
+
+	/* 只发送从机地址，从机应答则存在，非应答则不存在；探测不能经过i2c_xfer_sync，它会拦截flag为0的从机 */
+	i2c_xfer_init(&xfer, &info, 0, 0, 0, 0);
+	info.flag = i2c_xfer_submit(&xfer) && i2c_xfer_wait(&xfer);
+	/* 返回I2C从机信息 */
+	return info;
+}
+
+/*!
+	\功能       按注册表填写尚未找到的模块的从机槽位：依次在每个接口上按候选地址的顺序查找，第一个存在的地址即该模块
+	\参数[输入] id: 模块标识，I2C_DEV_x
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_dev_slot_fill(i2c_dev_id id)
+{
+	const i2c_dev_desc * dev = &I2C_DEV_TAB[id];
+	i2c_slave_info * slot = &i2c_dev_slot[id];
+
+	/* 已找到的模块保持原来的地址，挂接的影子缓存和写合并缓冲不失效 */
+#ifdef I2C_TIMING_FORCE
+	slot->timing = I2C_TIMING_FORCE;
+#else
+	slot->timing = dev->timing;
+#endif
+	slot->prio = dev->prio;
+	for(int i=0; !slot->flag && (i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)); i++)
+	{
+		for(int a=0; !slot->flag && (a<dev->addr_num); a++)
+		{
+			if(i2c_slave_present(I2C_PERIPH_NUM[i], I2C_DEV_ADDR(dev, a)))
+			{
+				slot->periph = I2C_PERIPH_NUM[i];
+				slot->addr = I2C_DEV_ADDR(dev, a);
+				slot->flag = 1;
+			}
+		}
+	}
+}
+
+/*!
+	\功能       I2C总线扫描，初始化I2C并在每个接口上探测模块表中的所有候选地址一次，结果记入注册表和模块的从机槽位，
+	            并把每条总线的时钟速度设为其上所有从机都支持的最高速度；各接口上的探测同时进行
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_bus_scan(void)
+{
+	unsigned int start = delay_time_us();
+	unsigned int speed[sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)];
+	i2c_xfer xfer[sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)];
+	i2c_slave_info info =
+	{
+		.flag = 0,
+		.timing = I2C_TIMING_NONE,
+		.prio = I2C_PRIO_SENSOR,
+	};
+
+	i2c_init();
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	{
+		speed[i] = I2C_SPEED_FAST;
+	}
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		const i2c_dev_desc * dev = &I2C_DEV_TAB[d];
+
+		for(int a=0; a<dev->addr_num; a++)
+		{
+			/* 同一地址在所有接口上同时探测，扫描时间由最慢的一条总线决定，而不是各总线之和 */
+			info.addr = I2C_DEV_ADDR(dev, a);
+			for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+			{
+				info.periph = I2C_PERIPH_NUM[i];
+				i2c_xfer_init(&xfer[i], &info, 0, 0, 0, 0);
+				i2c_xfer_submit(&xfer[i]);
+			}
+			for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+			{
+				i2c_scan_stat.probe_count ++;
+				if(i2c_xfer_wait(&xfer[i]))
+				{
+					i2c_registry[i][info.addr >> 3] |= 1 << (info.addr & 0x07);
+					i2c_scan_stat.found_count ++;
+					if(dev->speed < speed[i])
+					{
+						speed[i] = dev->speed;
+					}
+				}
+			}
+		}
+	}
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	{
+		/* 新的速度在下一次启动传输时生效 */
+		i2c_bus_tab[i].speed_max = speed[i];
+	}
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		i2c_dev_slot_fill(d);
+	}
+	i2c_scanned = 1;
+	i2c_scan_stat.scan_us = delay_elapsed_us(start);
+}
+
+/*!
+	\功能       热插拔监视：低频率探测尚未找到的模块（从未找到或已拔出）的候选地址，每I2C_RESCAN_MS毫秒最多探测一个地址，
+	            主循环每次调用，未到时间时立即返回
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       1表示发现了新的从机，0表示没有
+*/
+int i2c_bus_rescan(void)
+{
+	const i2c_dev_desc * dev;
+	i2c_bus * bus;
+	unsigned char index;
+	unsigned char addr;
+	unsigned char found;
+	unsigned int primask;
+	i2c_slave_info info;
+
+	if(!i2c_scanned || (delay_time_ms() - i2c_rescan_time < I2C_RESCAN_MS))
+	{
+		return 0;
+	}
+	i2c_rescan_time = delay_time_ms();
+
+	/* 跳过已找到的模块和已存在的地址，最多遍历一轮 */
+	for(int n=0; n<sizeof(i2c_registry)/sizeof(i2c_registry[0])*I2C_DEV_ADDR_TOTAL; n++)
+	{
+		index = i2c_rescan_periph;
+		bus = &i2c_bus_tab[index];
+		dev = &I2C_DEV_TAB[i2c_rescan_dev];
+		found = i2c_dev_slot[i2c_rescan_dev].flag;
+		addr = I2C_DEV_ADDR(dev, i2c_rescan_addr);
+		if(++i2c_rescan_addr >= dev->addr_num)
+		{
+			i2c_rescan_addr = 0;
+			if(++i2c_rescan_dev >= I2C_DEV_NUM)
+			{
+				i2c_rescan_dev = 0;
+				i2c_rescan_periph = (i2c_rescan_periph + 1) % (sizeof(i2c_registry)/sizeof(i2c_registry[0]));
+			}
+		}
+		if(found || i2c_slave_present(bus->periph, addr))
+		{
+			continue;
+		}
+
+		info = i2c_slave_detect(bus->periph, addr);
+		if(info.flag)
+		{
+			/* 只记入注册表，模块的从机槽位在驱动重新初始化、调用i2c_dev_lookup时填写；传输结束中断也会修改注册表 */
+			primask = i2c_hal_irq_save();
+			i2c_registry[index][addr >> 3] |= 1 << (addr & 0x07);
+			i2c_hal_irq_restore(primask);
+			i2c_scan_stat.attach_count ++;
+			if(dev->speed < bus->speed_max)
+			{
+				/* 新从机不支持当前的速度，下一次启动传输时降速 */
+				bus->speed_max = dev->speed;
+			}
+		}
+		return info.flag;
+	}
+	return 0;
+}
+
+/*!
+	\功能       获取总线当前的时钟速度
+	\参数[输入] periph: I2C接口
+	\参数[输出] 无
+	\返回       时钟速度，接口无效时返回0
+*/
+unsigned int i2c_bus_speed_get(unsigned int periph)
+{
+	i2c_bus * bus = i2c_bus_get(periph);
+
+	return bus ? bus->speed : 0;
+}
+
+/*!
+	\功能       获取总线累计的占用时间，两次获取的差值即这段时间内传输占用总线的时间
+	\参数[输入] periph: I2C接口
+	\参数[输出] 无
+	\返回       占用时间（微秒），约71.6分钟回绕一次，差值运算不受回绕影响；接口无效时返回0
+*/
+unsigned int i2c_bus_busy_get(unsigned int periph)
+{
+	i2c_bus * bus = i2c_bus_get(periph);
+
+	return bus ? bus->busy_us : 0;
+}
+
+/*!
+	\功能       查询注册表中从机是否存在
+	\参数[输入] periph: I2C从机接口
+	\参数[输入] addr  : I2C从机地址
+	\参数[输出] 无
+	\返回       1表示存在，0表示不存在
+*/
+int i2c_slave_present(unsigned int periph, unsigned char addr)
+{
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	{
+		if(I2C_PERIPH_NUM[i] == periph)
+		{
+			return (i2c_registry[i][addr >> 3] >> (addr & 0x07)) & 0x01;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       获取模块的从机信息，首次调用时进行总线扫描；模块尚未找到时按注册表重新查找，用于热插拔后驱动重新初始化
+	\参数[输入] id: 模块标识，I2C_DEV_x
+	\参数[输出] 无
+	\返回       模块的从机槽位，始终有效，找到时flag为1，时序类型和优先级取自模块表
+*/
+i2c_slave_info * i2c_dev_lookup(i2c_dev_id id)
+{
+	if(!i2c_scanned)
+	{
+		i2c_bus_scan();
+	}
+	i2c_dev_slot_fill(id);
+	return &i2c_dev_slot[id];
+}
+
+/*!
+	\功能       查找覆盖指定寄存器范围的影子缓存
+	\参数[输入] info : I2C从机信息
+	\参数[输入] reg  : 寄存器的地址
+	\参数[输入] count: 寄存器个数
+	\参数[输出] 无
+	\返回       影子缓存，没有缓存完整覆盖该范围时返回NULL
+*/
+static i2c_shadow * i2c_shadow_find(i2c_slave_info * info, unsigned char reg, unsigned char count)
+{
+	for(i2c_shadow * shadow = info->shadow; shadow; shadow = shadow->next)
+	{
+		if((reg >= shadow->first) && (reg + count <= shadow->first + shadow->count))
+		{
+			return shadow;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       把写入或读取的数据记入影子缓存，只记录落在缓存范围内的寄存器
+	\参数[输入] info  : I2C从机信息
+	\参数[输入] reg   : 寄存器的地址
+	\参数[输入] pbytes: 数据
+	\参数[输入] count : 数据个数
+	\参数[输入] ok    : 传输是否成功，失败时从机的寄存器值未知，影子值作废
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_shadow_update(i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count, int ok)
+{
+	unsigned char index;
+
+	for(i2c_shadow * shadow = info->shadow; shadow; shadow = shadow->next)
+	{
+		for(int i=0; i<count; i++)
+		{
+			if((reg + i < shadow->first) || (reg + i >= shadow->first + shadow->count))
+			{
+				continue;
+			}
+			index = reg + i - shadow->first;
+			if(ok)
+			{
+				shadow->regs[index] = pbytes[i];
+				shadow->valid[index >> 3] |= 1 << (index & 0x07);
+			}
+			else
+			{
+				shadow->valid[index >> 3] &= ~(1 << (index & 0x07));
+			}
+		}
+	}
+}
+
+/*!
+	\功能       判断影子缓存中的寄存器是否全部有效，并可选地与数据比较
+	\参数[输入] shadow: 影子缓存
+	\参数[输入] reg   : 寄存器的地址
+	\参数[输入] pbytes: 要比较的数据，为NULL时只检查有效性
+	\参数[输入] count : 寄存器个数
+	\参数[输出] 无
+	\返回       1表示全部有效（且相同），0表示否
+*/
+static int i2c_shadow_match(i2c_shadow * shadow, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	unsigned char index;
+
+	for(int i=0; i<count; i++)
+	{
+		index = reg + i - shadow->first;
+		if(!(shadow->valid[index >> 3] & (1 << (index & 0x07))))
+		{
+			return 0;
+		}
+		if(pbytes && (shadow->regs[index] != pbytes[i]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
 
 /*!
-	\功能       延时
-	\参数[输入] ms: 延时时间（毫秒）
+	\功能       为从机的一段可缓存寄存器挂接影子缓存，影子值初始为无效；重复挂接时只清除影子值
+	\参数[输入] shadow: 影子缓存，由驱动静态分配
+	\参数[输入] info  : I2C从机信息
+	\参数[输入] first : 第一个寄存器的地址
+	\参数[输入] count : 寄存器个数，超过I2C_SHADOW_MAX时截断
 	\参数[输出] 无
 	\返回       无
 */
-void i2c_delay_ms(unsigned int ms)
+void i2c_shadow_attach(i2c_shadow * shadow, i2c_slave_info * info, unsigned char first, unsigned char count)
 {
-	for(unsigned int i=0;i<ms;i++)
-		for(unsigned int j=0;j<40000;j++);
+	i2c_shadow * node = info->shadow;
+
+	shadow->first = first;
+	shadow->count = (count > I2C_SHADOW_MAX) ? I2C_SHADOW_MAX : count;
+	for(int i=0; i<sizeof(shadow->valid); i++)
+	{
+		shadow->valid[i] = 0;
+	}
+
+	while(node && (node != shadow))
+	{
+		node = node->next;
+	}
+	if(node == 0)
+	{
+		shadow->next = info->shadow;
+		info->shadow = shadow;
+	}
 }
 
 /*!
-	\功能       I2C0接口配置
-	\参数[输入] 无
+	\功能       作废从机的所有影子值，用于从机复位等寄存器被从机自身改变的情况
+	\参数[输入] info: I2C从机信息
 	\参数[输出] 无
 	\返回       无
 */
-static void i2c0_gpio_config(void)
+void i2c_shadow_invalidate(i2c_slave_info * info)
 {
-	/* 使能GPIOB组引脚的时钟 */
-	rcu_periph_clock_enable(RCU_GPIOB);
+	for(i2c_shadow * shadow = info->shadow; shadow; shadow = shadow->next)
+	{
+		for(int i=0; i<sizeof(shadow->valid); i++)
+		{
+			shadow->valid[i] = 0;
+		}
+	}
+}
 
-	/* 设置GPIOB_8引脚为复用功能模式，内部上拉 */
-	gpio_mode_set(GPIOB, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_8);
-	/* 设置GPIOB_8引脚为开漏输出模式，最高输出速度为50MHZ */
-	gpio_output_options_set(GPIOB, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_8);
-	/* 设置GPIOB_8引脚为I2C0的SCL功能 */
-	gpio_af_set(GPIOB, GPIO_AF_4, GPIO_PIN_8);
+/*!
+	\功能       统计所有影子缓存的命中和未命中次数
+	\参数[输入] 无
+	\参数[输出] hit : 命中次数，即省去的总线传输次数
+	\参数[输出] miss: 未命中次数
+	\返回       无
+*/
+void i2c_shadow_stat_get(unsigned int * hit, unsigned int * miss)
+{
+	*hit = 0;
+	*miss = 0;
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		for(i2c_shadow * shadow = i2c_dev_slot[d].shadow; shadow; shadow = shadow->next)
+		{
+			*hit += shadow->hit;
+			*miss += shadow->miss;
+		}
+	}
+}
 
-	/* 设置GPIOB_9引脚为复用功能模式，内部上拉 */
-	gpio_mode_set(GPIOB, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_9);
-	/* 设置GPIOB_9引脚为开漏输出模式，最高输出速度为50MHZ */
-	gpio_output_options_set(GPIOB, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_9);
-	/* 设置GPIOB_9引脚为I2C0的SDA功能 */
-	gpio_af_set(GPIOB, GPIO_AF_4, GPIO_PIN_9);
+/*!
+	\功能       把一次寄存器写入并入暂存数据，只合并紧接在暂存数据之后或之前的写入
+	\参数[输入] coalesce: 写合并缓冲
+	\参数[输入] reg     : 寄存器的地址
+	\参数[输入] pbytes  : 要写入的数据
+	\参数[输入] count   : 要写入的个数
+	\参数[输出] 无
+	\返回       1表示已合并，0表示没有暂存数据、不相邻或缓冲已满
+*/
+static int i2c_coalesce_merge(i2c_coalesce * coalesce, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	if((coalesce->count == 0) || (coalesce->count + count > I2C_COALESCE_MAX))
+	{
+		return 0;
+	}
+	if(reg == coalesce->reg + coalesce->count)
+	{
+		for(int i=0; i<count; i++)
+		{
+			coalesce->bytes[coalesce->count + i] = pbytes[i];
+		}
+	}
+	else if(reg + count == coalesce->reg)
+	{
+		/* 从高地址向低地址依次写入（如数码管从右向左刷新），暂存数据后移 */
+		for(int i=coalesce->count-1; i>=0; i--)
+		{
+			coalesce->bytes[count + i] = coalesce->bytes[i];
+		}
+		for(int i=0; i<count; i++)
+		{
+			coalesce->bytes[i] = pbytes[i];
+		}
+		coalesce->reg = reg;
+	}
+	else
+	{
+		return 0;
+	}
+	coalesce->count += count;
+	coalesce->merged ++;
+	return 1;
 }
 
 /*!
-	\功能       I2C0参数配置
-	\参数[输入] 无
+	\功能       把暂存数据作为一次突发写入发送，结果记入影子缓存
+	\参数[输入] coalesce: 写合并缓冲
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功或没有暂存数据
+*/
+static int i2c_coalesce_send(i2c_coalesce * coalesce)
+{
+	unsigned char count = coalesce->count;
+	int result;
+
+	if(count == 0)
+	{
+		return 1;
+	}
+	coalesce->count = 0;
+	coalesce->flushed ++;
+	result = i2c_xfer_sync(coalesce->info, I2C_XFER_REG, coalesce->reg, coalesce->bytes, count);
+	if(I2C_SHADOW_ENABLE)
+	{
+		i2c_shadow_update(coalesce->info, coalesce->reg, coalesce->bytes, count, result);
+	}
+	return result;
+}
+
+/*!
+	\功能       为支持寄存器地址自动递增的从机挂接写合并缓冲；重复挂接时丢弃暂存数据
+	\参数[输入] coalesce: 写合并缓冲，由驱动静态分配
+	\参数[输入] info    : I2C从机信息
 	\参数[输出] 无
 	\返回       无
 */
-static void i2c0_parm_config(void)
+void i2c_coalesce_attach(i2c_coalesce * coalesce, i2c_slave_info * info)
+{
+	coalesce->info = info;
+	coalesce->count = 0;
+	info->coalesce = coalesce;
+}
+
+/*!
+	\功能       发送从机写合并缓冲中的暂存数据，驱动在一组写入结束时调用
+	\参数[输入] info: I2C从机信息
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功或没有暂存数据
+*/
+int i2c_coalesce_flush(i2c_slave_info * info)
 {
-	/* 使能I2C0的时钟 */
-	rcu_periph_clock_enable(RCU_I2C0);
-	/* 设置I2C0的时钟速度为I2C0_SPEED */
-	i2c_clock_config(I2C0, I2C0_SPEED, I2C_DTCY_2);
-	/* 设置I2C0的从机地址为I2C0_SLAVE_ADDR，地址格式为7bits */
-	i2c_mode_addr_config(I2C0, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, I2C0_SLAVE_ADDR);
-	/* 使能I2C0应答 */
-	i2c_ack_config(I2C0, I2C_ACK_ENABLE);
-	/* 使能I2C0 */
-	i2c_enable(I2C0);
+	return info->coalesce ? i2c_coalesce_send(info->coalesce) : 1;
 }
 
 /*!
-	\功能       I2C1接口配置
+	\功能       发送所有写合并缓冲中的暂存数据
 	\参数[输入] 无
 	\参数[输出] 无
+	\返回       执行结果，0表示有失败，1表示全部成功
+*/
+int i2c_coalesce_flush_all(void)
+{
+	int result = 1;
+
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		if(i2c_dev_slot[d].coalesce)
+		{
+			result &= i2c_coalesce_send(i2c_dev_slot[d].coalesce);
+		}
+	}
+	return result;
+}
+
+/*!
+	\功能       统计所有写合并缓冲的合并和刷新次数
+	\参数[输入] 无
+	\参数[输出] merged : 合并次数，即省去的总线传输次数
+	\参数[输出] flushed: 刷新时发送的突发写入次数
 	\返回       无
 */
-static void i2c1_gpio_config(void)
+void i2c_coalesce_stat_get(unsigned int * merged, unsigned int * flushed)
+{
+	*merged = 0;
+	*flushed = 0;
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		if(i2c_dev_slot[d].coalesce)
+		{
+			*merged += i2c_dev_slot[d].coalesce->merged;
+			*flushed += i2c_dev_slot[d].coalesce->flushed;
+		}
+	}
+}
+
+/*!
+	\功能       读取一条传输跟踪记录
+	\参数[输入] index: 记录序号，0为最早的一条
+	\参数[输出] entry: 跟踪记录
+	\返回       1表示成功，0表示序号超出已有记录或未使能跟踪
+*/
+int i2c_trace_entry_get(unsigned int index, i2c_trace_entry * entry)
 {
-	/* 使能GPIOF组引脚的时钟 */
-	rcu_periph_clock_enable(RCU_GPIOF);
+#if I2C_TRACE_ENABLE
+	unsigned int primask;
+	unsigned int total = i2c_trace_total;
+	unsigned int num = (total < I2C_TRACE_DEPTH) ? total : I2C_TRACE_DEPTH;
 
-	/* 设置GPIOF_1引脚为复用功能模式，内部上拉 */
-	gpio_mode_set(GPIOF, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_1);
-	/* 设置GPIOF_1引脚为开漏输出模式，最高输出速度为50MHZ */
-	gpio_output_options_set(GPIOF, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_1);
-	/* 设置GPIOF_1引脚为I2C1的SCL功能 */
-	gpio_af_set(GPIOF, GPIO_AF_4, GPIO_PIN_1);
+	if(index >= num)
+	{
+		return 0;
+	}
+	/* 关中断复制，防止复制过程中被传输结束中断覆盖 */
+	primask = i2c_hal_irq_save();
+	*entry = i2c_trace_buf[(total - num + index) % I2C_TRACE_DEPTH];
+	i2c_hal_irq_restore(primask);
+	return 1;
+#else
+	return 0;
+#endif
+}
 
-	/* 设置GPIOF_0引脚为复用功能模式，内部上拉 */
-	gpio_mode_set(GPIOF, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_0);
-	/* 设置GPIOF_0引脚为开漏输出模式，最高输出速度为50MHZ */
-	gpio_output_options_set(GPIOF, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_0);
-	/* 设置GPIOF_0引脚为I2C1的SDA功能 */
-	gpio_af_set(GPIOF, GPIO_AF_4, GPIO_PIN_0);
+/*!
+	\功能       获取从机传输统计
+	\参数[输入] index: 统计序号，按从机第一次传输的顺序
+	\参数[输出] 无
+	\返回       从机传输统计，序号超出时返回NULL
+*/
+const i2c_trace_dev * i2c_trace_dev_get(unsigned int index)
+{
+#if I2C_TRACE_ENABLE
+	return (index < i2c_trace_dev_num) ? &i2c_trace_dev_tab[index] : 0;
+#else
+	return 0;
+#endif
 }
 
 /*!
-	\功能       I2C1参数配置
-	\参数[输入] 无
+	\功能       由耗时直方图估算百分位耗时，结果为所在桶的上界，不超过最长耗时
+	\参数[输入] dev    : 从机传输统计
+	\参数[输入] percent: 百分位，如50、99
 	\参数[输出] 无
-	\返回       无
+	\返回       耗时（微秒）
 */
-static void i2c1_parm_config(void)
+unsigned int i2c_trace_percentile(const i2c_trace_dev * dev, unsigned int percent)
 {
-	/* 使能I2C1的时钟 */
-	rcu_periph_clock_enable(RCU_I2C1);
-	/* 设置I2C1的时钟速度为I2C1_SPEED */
-	i2c_clock_config(I2C1, I2C1_SPEED, I2C_DTCY_2);
-	/* 设置I2C1的从机地址为I2C1_SLAVE_ADDR，地址格式为7bits */
-	i2c_mode_addr_config(I2C1, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, I2C1_SLAVE_ADDR);
-	/* 使能I2C1应答 */
-	i2c_ack_config(I2C1, I2C_ACK_ENABLE);
-	/* 使能I2C1 */
-	i2c_enable(I2C1);
+	unsigned int target = (dev->calls * percent + 99) / 100;
+	unsigned int sum = 0;
+	unsigned int limit;
+
+	for(int i=0; i<I2C_TRACE_BUCKETS; i++)
+	{
+		sum += dev->hist[i];
+		if(sum >= target)
+		{
+			limit = (2u << i) - 1;
+			return (limit < dev->max_us) ? limit : dev->max_us;
+		}
+	}
+	return dev->max_us;
 }
 
 /*!
-	\功能       I2C初始化（包括I2C0和I2C1）
-	\参数[输入] 无
+	\功能       输出传输跟踪：先输出每个从机的统计，再按需输出环形缓冲区中的记录
+	\参数[输入] output : 输出函数，如串口发送
+	\参数[输入] entries: 1表示同时输出每条记录，0表示只输出从机统计
 	\参数[输出] 无
 	\返回       无
 */
-void i2c_init(void)
+void i2c_trace_dump(i2c_trace_output output, int entries)
 {
-	/* I2C0接口配置 */
-	i2c0_gpio_config();
-	/* I2C0参数配置 */
-	i2c0_parm_config();
+#if I2C_TRACE_ENABLE
+	char line[96];
+	const i2c_trace_dev * dev;
+	i2c_trace_entry entry;
+	unsigned int merged, flushed;
 
-	/* I2C1接口配置 */
-	i2c1_gpio_config();
-	/* I2C1参数配置 */
-	i2c1_parm_config();
-	/* 延时1ms */
-	i2c_delay_ms(1);
+	snprintf(line, sizeof(line), "i2c trace: %u xfers, %u devices\r\n", i2c_trace_total, i2c_trace_dev_num);
+	output(line);
+	i2c_coalesce_stat_get(&merged, &flushed);
+	snprintf(line, sizeof(line), "i2c coalesce: %u writes merged into %u bursts\r\n", merged, flushed);
+	output(line);
+	snprintf(line, sizeof(line), "i2c hotplug: %u attached, %u detached\r\n", i2c_scan_stat.attach_count, i2c_scan_stat.detach_count);
+	output(line);
+	for(unsigned int i=0; (dev = i2c_trace_dev_get(i)) != 0; i++)
+	{
+		snprintf(line, sizeof(line), "bus%u 0x%02X calls=%u err=%u bytes=%u total=%uus p50=%uus p99=%uus max=%uus\r\n",
+		         dev->bus, dev->addr, dev->calls, dev->errors, dev->bytes, dev->total_us,
+		         i2c_trace_percentile(dev, 50), i2c_trace_percentile(dev, 99), dev->max_us);
+		output(line);
+	}
+	for(unsigned int i=0; entries && i2c_trace_entry_get(i, &entry); i++)
+	{
+		snprintf(line, sizeof(line), "%10u bus%u 0x%02X %c reg=0x%02X n=%u %uus st=%u\r\n",
+		         entry.time, entry.bus, entry.addr, (entry.flags & I2C_XFER_READ) ? 'R' : 'W',
+		         entry.reg, entry.count, entry.duration, entry.status);
+		output(line);
+	}
+#endif
 }
 
 /*!
-	\功能       I2C从机检测
-	\参数[输入] periph: I2C从机接口，I2Cx(x=0,1,2)
-	\参数[输入] addr  : I2C从机地址
+	\功能       清除传输跟踪记录和从机统计
+	\参数[输入] 无
 	\参数[输出] 无
-	\返回       I2C从机信息
+	\返回       无
 */
-i2c_slave_info i2c_slave_detect(unsigned int periph, unsigned char addr)
+void i2c_trace_reset(void)
 {
-	/* I2C从机信息 */
-	i2c_slave_info info =
+#if I2C_TRACE_ENABLE
+	unsigned int primask = i2c_hal_irq_save();
+
+	for(int i=0; i<i2c_trace_dev_num; i++)
 	{
-		.periph = periph,
-		.addr = addr,
-		.flag = 0,
-	};
-	unsigned int i = 0;
-
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
-	i2c_master_addressing(periph, addr, I2C_TRANSMITTER);
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(periph, I2C_FLAG_ADDSEND))
-	{
-		/* 等待超时 */
-		if(++i > 100000)
-		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 从机状态清0，即从机不存在 */
-			info.flag = 0;
-			/* 返回I2C从机信息 */
-			return info;
-		}
-	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	/* 向I2C总线上发送停止信号 */
-	i2c_stop_on_bus(periph);
-	/* 从机状态置1，即从机存在 */
-	info.flag = 1;
-	/* 返回I2C从机信息 */
-	return info;
+		i2c_trace_dev_tab[i] = (i2c_trace_dev){0};
+	}
+	i2c_trace_dev_num = 0;
+	i2c_trace_total = 0;
+	i2c_hal_irq_restore(primask);
+#endif
 }
 
 /*!
@@ -182,42 +1440,14 @@ i2c_slave_info i2c_slave_detect(unsigned int periph, unsigned char addr)
 	\参数[输出] 无
 	\返回       执行结果，0表示失败，1表示成功
 */
-int i2c_byte_write(i2c_slave_info info, unsigned char byte)
+int i2c_byte_write(i2c_slave_info * info, unsigned char byte)
 {
-	unsigned int i = 0;
-
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(info.periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
-	i2c_master_addressing(info.periph, info.addr, I2C_TRANSMITTER);
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
+	if(I2C_COALESCE_ENABLE)
 	{
-		/* 等待超时 */
-		if(++i > 100000)
-		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
-		}
+		/* 保持写入顺序，先发送暂存数据 */
+		i2c_coalesce_flush(info);
 	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	/* 等待TBE位置位，即等待发送缓冲区为空 */
-	while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-	/* 向从机发送一个字节数据 */
-	i2c_data_transmit(info.periph, byte);
-	/* 等待BTC位置位，即等待数据发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-	/* 向I2C总线上发送停止信号 */
-	i2c_stop_on_bus(info.periph);
-	/* 返回执行结果 */
-	return 1;
+	return i2c_xfer_sync(info, 0, 0, &byte, 1);
 }
 
 /*!
@@ -228,50 +1458,9 @@ int i2c_byte_write(i2c_slave_info info, unsigned char byte)
 	\参数[输出] 无
 	\返回       执行结果，0表示失败，1表示成功
 */
-int i2c_reg_byte_write(i2c_slave_info info, unsigned char reg, unsigned char byte)
+int i2c_reg_byte_write(i2c_slave_info * info, unsigned char reg, unsigned char byte)
 {
-	unsigned int i = 0;
-
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(info.periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
-	i2c_master_addressing(info.periph, info.addr, I2C_TRANSMITTER);
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
-	{
-		/* 等待超时 */
-		if(++i > 100000)
-		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
-		}
-	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	/* 等待TBE位置位，即等待发送缓冲区为空 */
-	while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-	/* 向从机发送寄存器地址 */
-	i2c_data_transmit(info.periph, reg);
-	/* 等待BTC位置位，即等待寄存器地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-	/* 延时2ms */
-	i2c_delay_ms(2);
-	/* 等待TBE位置位，即等待发送缓冲区为空 */
-	while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-	/* 向从机发送一个字节数据 */
-	i2c_data_transmit(info.periph, byte);
-	/* 等待BTC位置位，即等待数据发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-	/* 向I2C总线上发送停止信号 */
-	i2c_stop_on_bus(info.periph);
-	/* 返回执行结果 */
-	return 1;
+	return i2c_reg_bytes_write(info, reg, &byte, 1);
 }
 
 /*!
@@ -281,140 +1470,154 @@ int i2c_reg_byte_write(i2c_slave_info info, unsigned char reg, unsigned char byt
 	\参数[输入] pbytes: 要写入的数据
 	\参数[输入] count : 要写入的个数
 	\参数[输出] 无
-	\返回       执行结果，0表示失败，1表示成功
+	\返回       执行结果，0表示失败，1表示成功；从机挂接写合并缓冲时写入可能只是暂存，发送结果由刷新返回
 */
-int i2c_reg_bytes_write(i2c_slave_info info, unsigned char reg, unsigned char * pbytes, unsigned char count)
+int i2c_reg_bytes_write(i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count)
 {
-	unsigned int i = 0;
+	int result = 1;
+	int ok;
+	i2c_shadow * shadow = I2C_SHADOW_ENABLE ? i2c_shadow_find(info, reg, count) : 0;
+	i2c_coalesce * coalesce = (I2C_COALESCE_ENABLE && info->flag) ? info->coalesce : 0;
 
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(info.periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
-	i2c_master_addressing(info.periph, info.addr, I2C_TRANSMITTER);
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
+	if(coalesce)
 	{
-		/* 等待超时 */
-		if(++i > 100000)
+		if(i2c_coalesce_merge(coalesce, reg, pbytes, count))
 		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
+			/* 与暂存数据相邻，即使与影子值相同也并入，多一个字节比多一次传输便宜 */
+			return 1;
 		}
+		/* 不相邻或缓冲已满，先发送暂存数据，影子缓存随之更新 */
+		result = i2c_coalesce_send(coalesce);
 	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	/* 等待TBE位置位，即等待发送缓冲区为空 */
-	while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-	/* 向从机发送寄存器地址 */
-	i2c_data_transmit(info.periph, reg);
-	/* 等待BTC位置位，即等待寄存器地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-	/* 循环发送所有数据 */
-	while(count --)
-	{
-		/* 等待TBE位置位，即等待发送缓冲区为空 */
-		while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-		/* 向从机发送一个字节数据 */
-		i2c_data_transmit(info.periph, *pbytes);
-		/* 等待BTC位置位，即等待数据发送完成 */
-		while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-		/* 数据指针指向下一个字节 */
-		pbytes ++;
-	}
-	/* 向I2C总线上发送停止信号 */
-	i2c_stop_on_bus(info.periph);
-	/* 返回执行结果 */
-	return 1;
-}
 
-/*!
-	\功能       从I2C从机读取多个字节数据
-	\参数[输入] info  : I2C从机信息
-	\参数[输入] count : 要读取的个数
-	\参数[输出] pbytes: 要读取的数据
-	\返回       执行结果，0表示失败，1表示成功
-*/
-int i2c_bytes_read(i2c_slave_info info, unsigned char * pbytes, unsigned char count)
-{
-	unsigned int i = 0;
+	if(shadow && info->flag)
+	{
+		if(i2c_shadow_match(shadow, reg, pbytes, count))
+		{
+			/* 从机中已是相同的值，省去本次写入 */
+			shadow->hit ++;
+			return result;
+		}
+		shadow->miss ++;
+	}
 
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(info.periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机接收 */
-	i2c_master_addressing(info.periph, info.addr, I2C_RECEIVER);		
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
+	if(coalesce && (count <= I2C_COALESCE_MAX))
 	{
-		/* 等待超时 */
-		if(++i > 100000)
+		/* 暂存本次写入，等待后续相邻的写入，在刷新或访问该从机的其他操作时发送 */
+		for(int i=0; i<count; i++)
 		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
+			coalesce->bytes[i] = pbytes[i];
 		}
+		coalesce->reg = reg;
+		coalesce->count = count;
+		return result;
 	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	if(count <= 2)
+
+	/* 寄存器地址与数据之间的间隔由从机时序决定 */
+	ok = i2c_xfer_sync(info, I2C_XFER_REG, reg, pbytes, count);
+	if(I2C_SHADOW_ENABLE && info->flag)
 	{
-		/* 禁止I2C应答 */
-		i2c_ack_config(info.periph, I2C_ACK_DISABLE);
+		i2c_shadow_update(info, reg, pbytes, count, ok);
 	}
-	if(count == 2)
+	return result && ok;
+}
+
+/*!
+	\功能       把多段寄存器写入作为一次传输提交并等待完成，结果记入影子缓存
+	\参数[输入] info: I2C从机信息
+	\参数[输入] segs: 写入段
+	\参数[输入] num : 段的个数，不为0
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+static int i2c_segs_sync(i2c_slave_info * info, const i2c_seg * segs, unsigned char num)
+{
+	i2c_xfer xfer;
+	int result;
+
+	if(!info->flag)
 	{
-		/* 下一字节接收结束后发送非应答信号 */
-		i2c_ackpos_config(info.periph, I2C_ACKPOS_NEXT);
+		/* 未检测到的从机直接返回失败，不占用总线 */
+		return 0;
 	}
-	if(count == 1)
+	i2c_xfer_init(&xfer, info, I2C_XFER_REG, segs[0].reg, segs[0].pbytes, segs[0].count);
+	xfer.segs = segs + 1;
+	xfer.seg_num = num - 1;
+	result = i2c_xfer_run(&xfer);
+	for(int i=0; I2C_SHADOW_ENABLE && (i<num); i++)
 	{
-		/* 向I2C总线上发送停止信号 */
-		i2c_stop_on_bus(info.periph);
+		i2c_shadow_update(info, segs[i].reg, segs[i].pbytes, segs[i].count, result);
 	}
-	/* 循环接收所有数据 */
-	while(count)
+	return result;
+}
+
+/*!
+	\功能       向量写：把多段寄存器写入作为一次传输发送，段之间用重复起始信号衔接，不释放总线，
+	            省去每段单独传输时的排队、启动和停止开销；与影子值相同的段不发送，
+	            超过I2C_SEG_MAX段时分为多次传输
+	\参数[输入] info: I2C从机信息
+	\参数[输入] segs: 写入段
+	\参数[输入] num : 段的个数
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+int i2c_reg_segs_write(i2c_slave_info * info, const i2c_seg * segs, unsigned char num)
+{
+	i2c_seg pending[I2C_SEG_MAX];
+	unsigned char count = 0;
+	i2c_shadow * shadow;
+	int result = 1;
+
+	if(I2C_COALESCE_ENABLE && info->flag && info->coalesce)
 	{
-		if(count == 3)
+		/* 从机支持地址自动递增，各段经写合并缓冲，相邻的段合并为一次突发写入 */
+		for(int i=0; i<num; i++)
 		{
-			/* 等待BTC位置位，即等待数据发送完成 */
-			while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-			/* 禁止I2C应答 */
-			i2c_ack_config(info.periph, I2C_ACK_DISABLE);
+			result &= i2c_reg_bytes_write(info, segs[i].reg, segs[i].pbytes, segs[i].count);
 		}
-		if(count == 2)
+		return result;
+	}
+	for(int i=0; i<num; i++)
+	{
+		shadow = (I2C_SHADOW_ENABLE && info->flag) ? i2c_shadow_find(info, segs[i].reg, segs[i].count) : 0;
+		if(shadow)
 		{
-			/* 等待BTC位置位，即等待数据发送完成 */
-			while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
+			if(i2c_shadow_match(shadow, segs[i].reg, segs[i].pbytes, segs[i].count))
+			{
+				/* 从机中已是相同的值，省去这一段 */
+				shadow->hit ++;
+				continue;
+			}
+			shadow->miss ++;
 		}
-		/* 等待RBNE位置位，即等待接收缓冲区不为空 */
-		if(i2c_flag_get(info.periph, I2C_FLAG_RBNE))
+		pending[count++] = segs[i];
+		if(count == I2C_SEG_MAX)
 		{
-			/* 从从机接收一个字节数据 */
-			*pbytes = i2c_data_receive(info.periph);
-			/* 数据指针指向下一个字节 */
-			pbytes ++;
-			/* 剩余字节计数递减 */
-			count --;
+			result &= i2c_segs_sync(info, pending, count);
+			count = 0;
 		}
 	}
-	/* 使能I2C应答 */
-	i2c_ack_config(info.periph, I2C_ACK_ENABLE);
-	/* 当前字节接收结束后发送应答信号 */
-	i2c_ackpos_config(info.periph, I2C_ACKPOS_CURRENT);
-	/* 返回执行结果 */
-	return 1;
+	if(count)
+	{
+		result &= i2c_segs_sync(info, pending, count);
+	}
+	return result;
+}
+
+/*!
+	\功能       从I2C从机读取多个字节数据
+	\参数[输入] info  : I2C从机信息
+	\参数[输入] count : 要读取的个数
+	\参数[输出] pbytes: 要读取的数据
+	\返回       执行结果，0表示失败，1表示成功
+*/
+int i2c_bytes_read(i2c_slave_info * info, unsigned char * pbytes, unsigned char count)
+{
+	if(I2C_COALESCE_ENABLE)
+	{
+		i2c_coalesce_flush(info);
+	}
+	return i2c_xfer_sync(info, I2C_XFER_READ, 0, pbytes, count);
 }
 
 /*!
@@ -425,105 +1628,204 @@ int i2c_bytes_read(i2c_slave_info info, unsigned char * pbytes, unsigned char co
 	\参数[输出] pbytes: 要读取的数据
 	\返回       执行结果，0表示失败，1表示成功
 */
-int i2c_reg_bytes_read(i2c_slave_info info, unsigned char reg, unsigned char * pbytes, unsigned char count)
+int i2c_reg_bytes_read(i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count)
 {
-	unsigned int i = 0;
+	int result;
+	i2c_shadow * shadow = I2C_SHADOW_ENABLE ? i2c_shadow_find(info, reg, count) : 0;
 
-	/* 等待I2C总线变为空闲状态 */
-	while(i2c_flag_get(info.periph, I2C_FLAG_I2CBSY));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
-	i2c_master_addressing(info.periph, info.addr, I2C_TRANSMITTER);
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
+	if(I2C_COALESCE_ENABLE)
 	{
-		/* 等待超时 */
-		if(++i > 100000)
+		/* 暂存数据发送后影子值才是最新的 */
+		i2c_coalesce_flush(info);
+	}
+	if(shadow && info->flag)
+	{
+		if(i2c_shadow_match(shadow, reg, 0, count))
 		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
+			/* 可缓存寄存器的值只由主机改变，直接返回影子值 */
+			for(int i=0; i<count; i++)
+			{
+				pbytes[i] = shadow->regs[reg + i - shadow->first];
+			}
+			shadow->hit ++;
+			return 1;
 		}
+		shadow->miss ++;
 	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	/* 等待TBE位置位，即等待发送缓冲区为空 */
-	while(SET != i2c_flag_get(info.periph, I2C_FLAG_TBE));
-	/* 向从机发送寄存器地址 */
-	i2c_data_transmit(info.periph, reg);
-	/* 等待BTC位置位，即等待寄存器地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-	/* 向I2C总线上发送起始信号 */
-	i2c_start_on_bus(info.periph);
-	/* 等待SBSEND位置位，即等待起始信号发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_SBSEND));
-	/* 向I2C总线上发送从机地址，指定后续数据为主机接收 */
-	i2c_master_addressing(info.periph, info.addr, I2C_RECEIVER);		
-	/* 等待ADDSEND位置位，即等待从机地址发送完成 */
-	while(!i2c_flag_get(info.periph, I2C_FLAG_ADDSEND))
-	{
-		/* 等待超时 */
-		if(++i > 100000)
-		{
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
-			/* 返回执行结果 */
-			return 0;
-		}
+
+	result = i2c_xfer_sync(info, I2C_XFER_REG | I2C_XFER_READ, reg, pbytes, count);
+	if(I2C_SHADOW_ENABLE && info->flag && result)
+	{
+		i2c_shadow_update(info, reg, pbytes, count, result);
+	}
+	return result;
+}
+
+/*!
+	\功能       提交寄存器预取，立即返回：驱动在用到数据之前提前提交读操作，传输与另一条总线上的传输同时进行；
+	            上一次预取仍在进行时不重复提交
+	\参数[输入] prefetch: 预取描述，首次使用前清零
+	\参数[输入] info    : I2C从机信息
+	\参数[输入] reg     : 寄存器的地址
+	\参数[输入] pbytes  : 数据缓冲区，取走结果之前不得使用
+	\参数[输入] count   : 数据个数
+	\参数[输出] 无
+	\返回       执行结果，0表示失败，1表示成功
+*/
+int i2c_prefetch_start(i2c_prefetch * prefetch, i2c_slave_info * info, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	if(!info->flag)
+	{
+		return 0;
 	}
-	/* 清除ADDSEND位 */
-	i2c_flag_clear(info.periph, I2C_FLAG_ADDSEND);
-	if(count <= 2)
+	if(prefetch->xfer.status == I2C_XFER_PENDING)
 	{
-		/* 禁止I2C应答 */
-		i2c_ack_config(info.periph, I2C_ACK_DISABLE);
+		return 1;
 	}
-	if(count == 2)
+	if(I2C_COALESCE_ENABLE)
 	{
-		/* 下一字节接收结束后发送非应答信号 */
-		i2c_ackpos_config(info.periph, I2C_ACKPOS_NEXT);
+		i2c_coalesce_flush(info);
 	}
-	if(count == 1)
+	i2c_xfer_init(&prefetch->xfer, info, I2C_XFER_REG | I2C_XFER_READ, reg, pbytes, count);
+	prefetch->time = delay_time_us();
+	return i2c_xfer_submit(&prefetch->xfer);
+}
+
+/*!
+	\功能       取走预取的结果，传输未完成时等待；没有预取、预取失败或距提交超过I2C_PREFETCH_MAX_US时结果无效，
+	            由驱动改为阻塞读取
+	\参数[输入] prefetch: 预取描述
+	\参数[输出] 无
+	\返回       1表示缓冲区中是有效的结果，0表示无效
+*/
+int i2c_prefetch_take(i2c_prefetch * prefetch)
+{
+	int result;
+
+	if(prefetch->xfer.status == I2C_XFER_IDLE)
 	{
-		/* 向I2C总线上发送停止信号 */
-		i2c_stop_on_bus(info.periph);
+		return 0;
 	}
-	/* 循环接收所有数据 */
-	while(count)
+	/* 无论结果是否有效都等待传输结束，之后缓冲区才能用于阻塞读取 */
+	result = i2c_xfer_wait(&prefetch->xfer) && (delay_elapsed_us(prefetch->time) <= I2C_PREFETCH_MAX_US);
+	prefetch->xfer.status = I2C_XFER_IDLE;
+	return result;
+}
+
+/*!
+	\功能       输出总线分配报告：每条总线上的模块、时钟速度和占用的总线时间，
+	            以及把一个模块移到另一条总线上时最能平衡两条总线的建议，用于调整模块的接线
+	\参数[输入] output: 输出函数，如串口发送
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_placement_dump(i2c_trace_output output)
+{
+	char line[96];
+	unsigned int busy[sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)] = {0};
+	unsigned int total = 0;
+	const i2c_dev_desc * move = 0;
+	unsigned int move_us = 0;
+	unsigned char move_bus = 0;
+	unsigned int best = 0xFFFFFFFFu;
+	unsigned int busiest = 0;
+
+	/* 各模块占用的时间取自传输跟踪的从机统计，总线的时间为其上各模块之和；未使能跟踪时只列出模块 */
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
 	{
-		if(count == 3)
+#if I2C_TRACE_ENABLE
+		for(int k=0; k<i2c_trace_dev_num; k++)
 		{
-			/* 等待BTC位置位，即等待数据发送完成 */
-			while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-			/* 禁止I2C应答 */
-			i2c_ack_config(info.periph, I2C_ACK_DISABLE);
+			if(i2c_trace_dev_tab[k].bus == i)
+			{
+				busy[i] += i2c_trace_dev_tab[k].total_us;
+			}
 		}
-		if(count == 2)
+#endif
+		total += busy[i];
+	}
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	{
+		snprintf(line, sizeof(line), "i2c placement bus%u: %ukHz busy=%ums (%u%%)\r\n", i, i2c_bus_tab[i].speed / 1000,
+		         busy[i] / 1000, total ? (unsigned int)((unsigned long long)busy[i] * 100 / total) : 0);
+		output(line);
+		for(int d=0; d<I2C_DEV_NUM; d++)
 		{
-			/* 等待BTC位置位，即等待数据发送完成 */
-			while(!i2c_flag_get(info.periph, I2C_FLAG_BTC));
-			/* 向I2C总线上发送停止信号 */
-			i2c_stop_on_bus(info.periph);
+			const i2c_dev_desc * dev = &I2C_DEV_TAB[d];
+			const i2c_slave_info * slot = &i2c_dev_slot[d];
+			unsigned int dev_us = 0;
+
+			if(!slot->flag || (slot->periph != I2C_PERIPH_NUM[i]))
+			{
+				continue;
+			}
+#if I2C_TRACE_ENABLE
+			for(int k=0; k<i2c_trace_dev_num; k++)
+			{
+				if((i2c_trace_dev_tab[k].bus == i) && (i2c_trace_dev_tab[k].addr == slot->addr))
+				{
+					dev_us = i2c_trace_dev_tab[k].total_us;
+				}
+			}
+#endif
+			snprintf(line, sizeof(line), "  0x%02X %-10s %ukHz busy=%ums\r\n", slot->addr, dev->name, dev->speed / 1000, dev_us / 1000);
+			output(line);
+
+			/* 移动后两条总线中较忙的一条的时间越短越好；只在时钟速度相同的总线之间移动，模块的时间按原值估算 */
+			for(int k=0; k<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); k++)
+			{
+				unsigned int from = busy[i] - dev_us;
+				unsigned int to = busy[k] + dev_us;
+				unsigned int worst = (from > to) ? from : to;
+
+				if((k == i) || !dev_us || (i2c_bus_tab[k].speed != i2c_bus_tab[i].speed) || (worst >= best))
+				{
+					continue;
+				}
+				best = worst;
+				move = dev;
+				move_us = dev_us;
+				move_bus = k;
+			}
 		}
-		/* 等待RBNE位置位，即等待接收缓冲区不为空 */
-		if(i2c_flag_get(info.periph, I2C_FLAG_RBNE))
+	}
+	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	{
+		busiest = (busy[i] > busiest) ? busy[i] : busiest;
+	}
+	/* 移动后较忙的总线比现在最忙的总线轻时才建议移动 */
+	if(move && (best < busiest))
+	{
+		snprintf(line, sizeof(line), "i2c placement: moving %s (%ums) to bus%u would cut the busier bus to %ums\r\n",
+		         move->name, move_us / 1000, move_bus, best / 1000);
+		output(line);
+	}
+}
+
+/*!
+	\功能       输出每个模块的健康统计：传输次数、非应答、超时、总线错误、重试、重试后成功和最终失败的次数，
+	            只输出有过传输的模块
+	\参数[输入] output: 输出函数，如串口发送
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_health_dump(i2c_trace_output output)
+{
+	char line[128];
+
+	for(int d=0; d<I2C_DEV_NUM; d++)
+	{
+		const i2c_slave_info * slot = &i2c_dev_slot[d];
+		const i2c_health * health = &slot->health;
+		unsigned int bus = i2c_bus_get(slot->periph) - i2c_bus_tab;
+
+		if(health->xfers == 0)
 		{
-			/* 从从机接收一个字节数据 */
-			*pbytes = i2c_data_receive(info.periph);
-			/* 数据指针指向下一个字节 */
-			pbytes ++;
-			/* 剩余字节计数递减 */
-			count --;
+			continue;
 		}
+		snprintf(line, sizeof(line), "i2c health %-10s bus%u 0x%02X xfers=%u nack=%u timeout=%u buserr=%u retry=%u recovered=%u failed=%u%s\r\n",
+		         I2C_DEV_TAB[d].name, bus, slot->addr, health->xfers, health->nack, health->timeout, health->bus_error,
+		         health->retry, health->recovered, health->failed, slot->flag ? "" : " absent");
+		output(line);
 	}
-	/* 使能I2C应答 */
-	i2c_ack_config(info.periph, I2C_ACK_ENABLE);
-	/* 当前字节接收结束后发送应答信号 */
-	i2c_ackpos_config(info.periph, I2C_ACKPOS_CURRENT);
-	/* 返回执行结果 */
-	return 1;
 }
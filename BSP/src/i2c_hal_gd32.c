@@ -0,0 +1,860 @@
+#ifndef BSP_HAL_SIM
+#include "i2c_hal.h"
+
+/* 线上传输阶段 */
+#define I2C_HAL_PHASE_IDLE     0 /* 空闲 */
+#define I2C_HAL_PHASE_START    1 /* 已发送起始信号，等待发送从机地址 */
+#define I2C_HAL_PHASE_TX       2 /* 主机发送寄存器地址和数据 */
+#define I2C_HAL_PHASE_RESTART  3 /* 已发送重复起始信号，等待发送读地址 */
+#define I2C_HAL_PHASE_RX       4 /* 主机接收数据 */
+
+/* GD32 I2C接口状态 */
+typedef struct
+{
+	unsigned int periph;          /* I2C接口 */
+	i2c_xfer * xfer;              /* 正在进行的传输 */
+	volatile unsigned char phase; /* 线上传输阶段 */
+	unsigned char reg_sent;       /* 寄存器地址是否已发送 */
+	unsigned char gap_done;       /* 寄存器间隔是否已结束 */
+	unsigned char index;          /* 当前段已传输的数据个数 */
+	unsigned char seg;            /* 已开始的后续段个数，即xfer->segs的下标 */
+	unsigned char reg;            /* 当前段的寄存器地址 */
+	unsigned char * pbytes;       /* 当前段的数据缓冲区 */
+	unsigned char count;          /* 当前段的数据个数 */
+	unsigned char dma;            /* 数据阶段是否正在使用DMA */
+	dma_channel_enum dma_rx;      /* 接收DMA通道（DMA0） */
+	dma_channel_enum dma_tx;      /* 发送DMA通道（DMA0） */
+	dma_subperipheral_enum dma_subperi; /* DMA通道外设选择 */
+	unsigned int gpio;            /* SCL和SDA引脚所在的GPIO组，用于总线恢复 */
+	unsigned int scl;             /* SCL引脚 */
+	unsigned int sda;             /* SDA引脚 */
+	unsigned int own_addr;        /* I2C自身的从机地址 */
+}i2c_hal_bus;
+
+/* GD32 I2C接口状态表，与I2C_PERIPH_NUM一一对应 */
+static i2c_hal_bus i2c_hal_tab[] =
+{
+	/* I2C0_RX: DMA0_CH0，I2C0_TX: DMA0_CH6，外设选择1 */
+	{.periph = I2C0, .dma_rx = DMA_CH0, .dma_tx = DMA_CH6, .dma_subperi = DMA_SUBPERI1,
+	 .gpio = GPIOB, .scl = GPIO_PIN_8, .sda = GPIO_PIN_9, .own_addr = I2C0_SLAVE_ADDR},
+	/* I2C1_RX: DMA0_CH2，I2C1_TX: DMA0_CH7，外设选择7 */
+	{.periph = I2C1, .dma_rx = DMA_CH2, .dma_tx = DMA_CH7, .dma_subperi = DMA_SUBPERI7,
+	 .gpio = GPIOF, .scl = GPIO_PIN_1, .sda = GPIO_PIN_0, .own_addr = I2C1_SLAVE_ADDR},
+};
+
+/*!
+	\功能       I2C0接口配置
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c0_gpio_config(void)
+{
+	/* 使能GPIOB组引脚的时钟 */
+	rcu_periph_clock_enable(RCU_GPIOB);
+
+	/* 设置GPIOB_8引脚为复用功能模式，内部上拉 */
+	gpio_mode_set(GPIOB, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_8);
+	/* 设置GPIOB_8引脚为开漏输出模式，最高输出速度为50MHZ */
+	gpio_output_options_set(GPIOB, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_8);
+	/* 设置GPIOB_8引脚为I2C0的SCL功能 */
+	gpio_af_set(GPIOB, GPIO_AF_4, GPIO_PIN_8);
+
+	/* 设置GPIOB_9引脚为复用功能模式，内部上拉 */
+	gpio_mode_set(GPIOB, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_9);
+	/* 设置GPIOB_9引脚为开漏输出模式，最高输出速度为50MHZ */
+	gpio_output_options_set(GPIOB, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_9);
+	/* 设置GPIOB_9引脚为I2C0的SDA功能 */
+	gpio_af_set(GPIOB, GPIO_AF_4, GPIO_PIN_9);
+}
+
+/*!
+	\功能       I2C0参数配置
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c0_parm_config(void)
+{
+	/* 使能I2C0的时钟 */
+	rcu_periph_clock_enable(RCU_I2C0);
+	/* 设置I2C0的时钟速度为I2C0_SPEED */
+	i2c_clock_config(I2C0, I2C0_SPEED, I2C_DTCY_2);
+	/* 设置I2C0的从机地址为I2C0_SLAVE_ADDR，地址格式为7bits */
+	i2c_mode_addr_config(I2C0, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, I2C0_SLAVE_ADDR);
+	/* 使能I2C0应答 */
+	i2c_ack_config(I2C0, I2C_ACK_ENABLE);
+	/* 使能I2C0 */
+	i2c_enable(I2C0);
+}
+
+/*!
+	\功能       I2C1接口配置
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c1_gpio_config(void)
+{
+	/* 使能GPIOF组引脚的时钟 */
+	rcu_periph_clock_enable(RCU_GPIOF);
+
+	/* 设置GPIOF_1引脚为复用功能模式，内部上拉 */
+	gpio_mode_set(GPIOF, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_1);
+	/* 设置GPIOF_1引脚为开漏输出模式，最高输出速度为50MHZ */
+	gpio_output_options_set(GPIOF, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_1);
+	/* 设置GPIOF_1引脚为I2C1的SCL功能 */
+	gpio_af_set(GPIOF, GPIO_AF_4, GPIO_PIN_1);
+
+	/* 设置GPIOF_0引脚为复用功能模式，内部上拉 */
+	gpio_mode_set(GPIOF, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_0);
+	/* 设置GPIOF_0引脚为开漏输出模式，最高输出速度为50MHZ */
+	gpio_output_options_set(GPIOF, GPIO_OTYPE_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_0);
+	/* 设置GPIOF_0引脚为I2C1的SDA功能 */
+	gpio_af_set(GPIOF, GPIO_AF_4, GPIO_PIN_0);
+}
+
+/*!
+	\功能       I2C1参数配置
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c1_parm_config(void)
+{
+	/* 使能I2C1的时钟 */
+	rcu_periph_clock_enable(RCU_I2C1);
+	/* 设置I2C1的时钟速度为I2C1_SPEED */
+	i2c_clock_config(I2C1, I2C1_SPEED, I2C_DTCY_2);
+	/* 设置I2C1的从机地址为I2C1_SLAVE_ADDR，地址格式为7bits */
+	i2c_mode_addr_config(I2C1, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, I2C1_SLAVE_ADDR);
+	/* 使能I2C1应答 */
+	i2c_ack_config(I2C1, I2C_ACK_ENABLE);
+	/* 使能I2C1 */
+	i2c_enable(I2C1);
+}
+
+/*!
+	\功能       判断传输的数据阶段是否使用DMA
+	\参数[输入] count: 数据个数
+	\参数[输出] 无
+	\返回       1表示使用DMA，0表示逐字节中断传输
+*/
+static int i2c_dma_use(unsigned char count)
+{
+	/* 单字节传输配置DMA的开销大于收益，仍逐字节传输 */
+	return I2C_DMA_ENABLE && (count >= I2C_DMA_MIN_COUNT);
+}
+
+/*!
+	\功能       启动数据阶段的DMA传输
+	\参数[输入] hw    : 接口状态
+	\参数[输入] pbytes: 数据缓冲区
+	\参数[输入] count : 数据个数
+	\参数[输入] rx    : 1表示接收，0表示发送
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_dma_start(i2c_hal_bus * hw, unsigned char * pbytes, unsigned char count, int rx)
+{
+	dma_single_data_parameter_struct dma_init_struct;
+	dma_channel_enum channel = rx ? hw->dma_rx : hw->dma_tx;
+
+	/* 复位DMA通道 */
+	dma_deinit(DMA0, channel);
+	dma_single_data_para_struct_init(&dma_init_struct);
+	/* 外设地址为I2C数据寄存器，地址固定 */
+	dma_init_struct.periph_addr = (uint32_t)&I2C_DATA(hw->periph);
+	dma_init_struct.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+	/* 存储器地址为数据缓冲区，地址递增 */
+	dma_init_struct.memory0_addr = (uint32_t)pbytes;
+	dma_init_struct.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+	dma_init_struct.periph_memory_width = DMA_PERIPH_WIDTH_8BIT;
+	dma_init_struct.circular_mode = DMA_CIRCULAR_MODE_DISABLE;
+	dma_init_struct.direction = rx ? DMA_PERIPH_TO_MEMORY : DMA_MEMORY_TO_PERIPH;
+	dma_init_struct.number = count;
+	dma_init_struct.priority = DMA_PRIORITY_HIGH;
+	dma_single_data_mode_init(DMA0, channel, &dma_init_struct);
+	dma_channel_subperipheral_select(DMA0, channel, hw->dma_subperi);
+	/* 传输完成后产生中断 */
+	dma_interrupt_enable(DMA0, channel, DMA_CHXCTL_FTFIE);
+	dma_channel_enable(DMA0, channel);
+
+	if(rx)
+	{
+		/* 最后一个字节由硬件自动发送非应答信号 */
+		i2c_dma_last_transfer_config(hw->periph, I2C_DMALST_ON);
+	}
+	/* 使能I2C的DMA请求 */
+	i2c_dma_config(hw->periph, I2C_DMA_ON);
+	hw->dma = 1;
+}
+
+/*!
+	\功能       停止数据阶段的DMA传输
+	\参数[输入] hw: 接口状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_dma_stop(i2c_hal_bus * hw)
+{
+	i2c_dma_config(hw->periph, I2C_DMA_OFF);
+	i2c_dma_last_transfer_config(hw->periph, I2C_DMALST_OFF);
+	dma_channel_disable(DMA0, hw->dma_rx);
+	dma_channel_disable(DMA0, hw->dma_tx);
+	hw->dma = 0;
+}
+
+/*!
+	\功能       关闭接口的事件、错误和缓冲区中断
+	\参数[输入] periph: I2C接口
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_hal_int_disable(unsigned int periph)
+{
+	i2c_interrupt_disable(periph, I2C_INT_BUF);
+	i2c_interrupt_disable(periph, I2C_INT_EV);
+	i2c_interrupt_disable(periph, I2C_INT_ERR);
+}
+
+/*!
+	\功能       结束线上传输，恢复应答配置后通知i2c.c，i2c.c可能在其中启动下一个传输
+	\参数[输入] hw    : 接口状态
+	\参数[输入] status: 传输状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_hal_finish(i2c_hal_bus * hw, unsigned char status)
+{
+	if(hw->dma)
+	{
+		/* 传输出错时DMA可能尚未完成 */
+		i2c_dma_stop(hw);
+	}
+	/* 使能I2C应答，当前字节接收结束后发送应答信号 */
+	i2c_ack_config(hw->periph, I2C_ACK_ENABLE);
+	i2c_ackpos_config(hw->periph, I2C_ACKPOS_CURRENT);
+
+	hw->xfer = 0;
+	hw->phase = I2C_HAL_PHASE_IDLE;
+	i2c_hal_done(hw - i2c_hal_tab, status);
+}
+
+/*!
+	\功能       载入向量写的一段，从寄存器地址开始发送
+	\参数[输入] hw : 接口状态
+	\参数[输入] seg: 写入段
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_hal_seg_load(i2c_hal_bus * hw, const i2c_seg * seg)
+{
+	hw->reg = seg->reg;
+	hw->pbytes = seg->pbytes;
+	hw->count = seg->count;
+	hw->reg_sent = 0;
+	hw->gap_done = 0;
+	hw->index = 0;
+}
+
+/*!
+	\功能       主机发送阶段的事件处理
+	\参数[输入] hw  : 接口状态
+	\参数[输入] xfer: 当前传输
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_tx_event(i2c_hal_bus * hw, i2c_xfer * xfer)
+{
+	unsigned int periph = hw->periph;
+
+	if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_TBE))
+	{
+		if((xfer->flags & I2C_XFER_REG) && !hw->reg_sent)
+		{
+			/* 向从机发送寄存器地址 */
+			i2c_data_transmit(periph, hw->reg);
+			hw->reg_sent = 1;
+			if((xfer->flags & I2C_XFER_READ) || (xfer->gap && hw->count))
+			{
+				/* 需要重复起始或间隔，等待BTC位置位 */
+				i2c_interrupt_disable(periph, I2C_INT_BUF);
+			}
+		}
+		else if(!(xfer->flags & I2C_XFER_READ) && (hw->index < hw->count))
+		{
+			if((hw->index == 0) && i2c_dma_use(hw->count))
+			{
+				/* 数据由DMA写入，DMA完成前不响应事件中断 */
+				i2c_interrupt_disable(periph, I2C_INT_BUF);
+				i2c_interrupt_disable(periph, I2C_INT_EV);
+				i2c_dma_start(hw, hw->pbytes, hw->count, 0);
+			}
+			else
+			{
+				/* 向从机发送一个字节数据 */
+				i2c_data_transmit(periph, hw->pbytes[hw->index++]);
+			}
+		}
+		else
+		{
+			/* 数据已全部写入，等待BTC位置位 */
+			i2c_interrupt_disable(periph, I2C_INT_BUF);
+		}
+	}
+	else if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_BTC))
+	{
+		if(xfer->flags & I2C_XFER_READ)
+		{
+			/* 寄存器地址发送完成，发送重复起始信号转入接收 */
+			hw->phase = I2C_HAL_PHASE_RESTART;
+			i2c_start_on_bus(periph);
+		}
+		else if(xfer->gap && !hw->gap_done && (hw->index < hw->count))
+		{
+			/* 从机需要间隔，SCL保持拉低，由i2c.c在间隔结束后调用i2c_hal_resume */
+			i2c_interrupt_disable(periph, I2C_INT_EV);
+			i2c_hal_gap(hw - i2c_hal_tab);
+		}
+		else if(hw->seg < xfer->seg_num)
+		{
+			/* 向量写的下一段：发送重复起始信号，不释放总线 */
+			i2c_hal_seg_load(hw, &xfer->segs[hw->seg++]);
+			hw->phase = I2C_HAL_PHASE_START;
+			i2c_interrupt_enable(periph, I2C_INT_BUF);
+			i2c_start_on_bus(periph);
+		}
+		else
+		{
+			/* 向I2C总线上发送停止信号 */
+			i2c_stop_on_bus(periph);
+			i2c_hal_finish(hw, I2C_XFER_DONE);
+		}
+	}
+}
+
+/*!
+	\功能       主机接收阶段的事件处理
+	\参数[输入] hw  : 接口状态
+	\参数[输入] xfer: 当前传输
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_rx_event(i2c_hal_bus * hw, i2c_xfer * xfer)
+{
+	unsigned int periph = hw->periph;
+	unsigned char remain = xfer->count - hw->index;
+
+	if(remain > 3)
+	{
+		if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_RBNE))
+		{
+			/* 从从机接收一个字节数据 */
+			xfer->pbytes[hw->index++] = i2c_data_receive(periph);
+			if(remain == 4)
+			{
+				/* 剩余3个字节时改为等待BTC，以便在最后一个字节前关闭应答 */
+				i2c_interrupt_disable(periph, I2C_INT_BUF);
+			}
+		}
+	}
+	else if(remain == 3)
+	{
+		if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_BTC))
+		{
+			/* 禁止I2C应答，最后一个字节接收结束后发送非应答信号 */
+			i2c_ack_config(periph, I2C_ACK_DISABLE);
+			xfer->pbytes[hw->index++] = i2c_data_receive(periph);
+		}
+	}
+	else if(remain == 2)
+	{
+		if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_BTC))
+		{
+			/* 向I2C总线上发送停止信号，再读出最后两个字节 */
+			i2c_stop_on_bus(periph);
+			xfer->pbytes[hw->index++] = i2c_data_receive(periph);
+			xfer->pbytes[hw->index++] = i2c_data_receive(periph);
+			i2c_hal_finish(hw, I2C_XFER_DONE);
+		}
+	}
+	else
+	{
+		if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_RBNE))
+		{
+			/* 停止信号已在地址阶段发送，读出唯一的字节 */
+			xfer->pbytes[hw->index++] = i2c_data_receive(periph);
+			i2c_hal_finish(hw, I2C_XFER_DONE);
+		}
+	}
+}
+
+/*!
+	\功能       接收方向的从机地址发送完成处理
+	\参数[输入] hw  : 接口状态
+	\参数[输入] xfer: 当前传输
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_rx_addsend(i2c_hal_bus * hw, i2c_xfer * xfer)
+{
+	unsigned int periph = hw->periph;
+
+	if(hw->dma)
+	{
+		/* 数据由DMA读取，DMA完成前不响应事件中断 */
+		i2c_interrupt_disable(periph, I2C_INT_EV);
+		i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_ADDSEND);
+	}
+	else if(xfer->count == 1)
+	{
+		/* 禁止I2C应答，清除ADDSEND位后立即发送停止信号 */
+		i2c_ack_config(periph, I2C_ACK_DISABLE);
+		i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_ADDSEND);
+		i2c_stop_on_bus(periph);
+	}
+	else if(xfer->count == 2)
+	{
+		/* 禁止I2C应答，下一字节接收结束后发送非应答信号，等待BTC位置位 */
+		i2c_ack_config(periph, I2C_ACK_DISABLE);
+		i2c_ackpos_config(periph, I2C_ACKPOS_NEXT);
+		i2c_interrupt_disable(periph, I2C_INT_BUF);
+		i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_ADDSEND);
+	}
+	else
+	{
+		if(xfer->count == 3)
+		{
+			/* 只有3个字节时直接等待BTC位置位 */
+			i2c_interrupt_disable(periph, I2C_INT_BUF);
+		}
+		i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_ADDSEND);
+	}
+}
+
+/*!
+	\功能       I2C事件中断处理
+	\参数[输入] hw: 接口状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_event_handler(i2c_hal_bus * hw)
+{
+	unsigned int periph = hw->periph;
+	i2c_xfer * xfer = hw->xfer;
+
+	if(xfer == 0)
+	{
+		/* 没有传输，关闭中断 */
+		i2c_interrupt_disable(periph, I2C_INT_BUF);
+		i2c_interrupt_disable(periph, I2C_INT_EV);
+		return;
+	}
+
+	if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_SBSEND))
+	{
+		if((hw->phase == I2C_HAL_PHASE_RESTART) || ((xfer->flags & (I2C_XFER_REG | I2C_XFER_READ)) == I2C_XFER_READ))
+		{
+			/* 向I2C总线上发送从机地址，指定后续数据为主机接收 */
+			hw->phase = I2C_HAL_PHASE_RX;
+			if(i2c_dma_use(xfer->count))
+			{
+				/* 接收DMA必须在清除ADDSEND位之前使能 */
+				i2c_interrupt_disable(periph, I2C_INT_BUF);
+				i2c_dma_start(hw, xfer->pbytes, xfer->count, 1);
+			}
+			else
+			{
+				i2c_interrupt_enable(periph, I2C_INT_BUF);
+			}
+			i2c_master_addressing(periph, xfer->addr, I2C_RECEIVER);
+		}
+		else
+		{
+			/* 向I2C总线上发送从机地址，指定后续数据为主机发送 */
+			hw->phase = I2C_HAL_PHASE_TX;
+			i2c_master_addressing(periph, xfer->addr, I2C_TRANSMITTER);
+		}
+	}
+	else if(i2c_interrupt_flag_get(periph, I2C_INT_FLAG_ADDSEND))
+	{
+		if(hw->phase == I2C_HAL_PHASE_RX)
+		{
+			i2c_rx_addsend(hw, xfer);
+		}
+		else
+		{
+			/* 清除ADDSEND位 */
+			i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_ADDSEND);
+			if(!(xfer->flags & I2C_XFER_REG) && (xfer->count == 0))
+			{
+				/* 没有数据的传输（从机检测），从机已应答 */
+				i2c_stop_on_bus(periph);
+				i2c_hal_finish(hw, I2C_XFER_DONE);
+			}
+		}
+	}
+	else if(hw->phase == I2C_HAL_PHASE_TX)
+	{
+		i2c_tx_event(hw, xfer);
+	}
+	else if(hw->phase == I2C_HAL_PHASE_RX)
+	{
+		i2c_rx_event(hw, xfer);
+	}
+}
+
+/*!
+	\功能       I2C错误中断处理
+	\参数[输入] hw: 接口状态
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_error_handler(i2c_hal_bus * hw)
+{
+	unsigned int periph = hw->periph;
+	int lostarb = (SET == i2c_interrupt_flag_get(periph, I2C_INT_FLAG_LOSTARB));
+	int berr = (SET == i2c_interrupt_flag_get(periph, I2C_INT_FLAG_BERR));
+
+	/* 清除错误标志：非应答、仲裁丢失、总线错误 */
+	i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_AERR);
+	i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_LOSTARB);
+	i2c_interrupt_flag_clear(periph, I2C_INT_FLAG_BERR);
+
+	if(hw->xfer)
+	{
+		if(!lostarb)
+		{
+			/* 仲裁丢失时已失去总线控制权，其余情况主动释放总线 */
+			i2c_stop_on_bus(periph);
+		}
+		i2c_hal_finish(hw, lostarb ? I2C_XFER_ARLO : (berr ? I2C_XFER_BERR : I2C_XFER_NACK));
+	}
+	else
+	{
+		i2c_interrupt_disable(periph, I2C_INT_ERR);
+	}
+}
+
+/*!
+	\功能       I2C的DMA传输完成中断处理
+	\参数[输入] hw     : 接口状态
+	\参数[输入] channel: DMA通道
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_dma_handler(i2c_hal_bus * hw, dma_channel_enum channel)
+{
+	if(RESET == dma_interrupt_flag_get(DMA0, channel, DMA_INT_FLAG_FTF))
+	{
+		return;
+	}
+	dma_interrupt_flag_clear(DMA0, channel, DMA_INT_FLAG_FTF);
+	if((hw->xfer == 0) || !hw->dma)
+	{
+		return;
+	}
+
+	i2c_dma_stop(hw);
+	hw->index = hw->count;
+	if(channel == hw->dma_rx)
+	{
+		/* 最后一个字节已读出，向I2C总线上发送停止信号 */
+		i2c_stop_on_bus(hw->periph);
+		i2c_hal_finish(hw, I2C_XFER_DONE);
+	}
+	else
+	{
+		/* 最后一个字节已写入，等待BTC位置位后发送停止信号 */
+		i2c_interrupt_enable(hw->periph, I2C_INT_EV);
+	}
+}
+
+/*!
+	\功能       DMA0通道0中断服务程序（I2C0接收）
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void DMA0_Channel0_IRQHandler(void)
+{
+	i2c_dma_handler(&i2c_hal_tab[0], DMA_CH0);
+}
+
+/*!
+	\功能       DMA0通道6中断服务程序（I2C0发送）
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void DMA0_Channel6_IRQHandler(void)
+{
+	i2c_dma_handler(&i2c_hal_tab[0], DMA_CH6);
+}
+
+/*!
+	\功能       DMA0通道2中断服务程序（I2C1接收）
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void DMA0_Channel2_IRQHandler(void)
+{
+	i2c_dma_handler(&i2c_hal_tab[1], DMA_CH2);
+}
+
+/*!
+	\功能       DMA0通道7中断服务程序（I2C1发送）
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void DMA0_Channel7_IRQHandler(void)
+{
+	i2c_dma_handler(&i2c_hal_tab[1], DMA_CH7);
+}
+
+/*!
+	\功能       I2C0事件中断服务程序
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void I2C0_EV_IRQHandler(void)
+{
+	i2c_event_handler(&i2c_hal_tab[0]);
+}
+
+/*!
+	\功能       I2C0错误中断服务程序
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void I2C0_ER_IRQHandler(void)
+{
+	i2c_error_handler(&i2c_hal_tab[0]);
+}
+
+/*!
+	\功能       I2C1事件中断服务程序
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void I2C1_EV_IRQHandler(void)
+{
+	i2c_event_handler(&i2c_hal_tab[1]);
+}
+
+/*!
+	\功能       I2C1错误中断服务程序
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void I2C1_ER_IRQHandler(void)
+{
+	i2c_error_handler(&i2c_hal_tab[1]);
+}
+
+/*!
+	\功能       I2C0和I2C1的引脚、参数、中断和DMA初始化
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_init(void)
+{
+	/* I2C0接口配置 */
+	i2c0_gpio_config();
+	/* I2C0参数配置 */
+	i2c0_parm_config();
+
+	/* I2C1接口配置 */
+	i2c1_gpio_config();
+	/* I2C1参数配置 */
+	i2c1_parm_config();
+
+	/* 在NVIC中使能I2C0和I2C1的事件和错误中断，优先级高于Timer0中断 */
+	nvic_irq_enable(I2C0_EV_IRQn, 0, 1);
+	nvic_irq_enable(I2C0_ER_IRQn, 0, 0);
+	nvic_irq_enable(I2C1_EV_IRQn, 0, 1);
+	nvic_irq_enable(I2C1_ER_IRQn, 0, 0);
+
+	/* 使能DMA0的时钟，在NVIC中使能I2C使用的DMA通道中断 */
+	rcu_periph_clock_enable(RCU_DMA0);
+	nvic_irq_enable(DMA0_Channel0_IRQn, 0, 1);
+	nvic_irq_enable(DMA0_Channel6_IRQn, 0, 1);
+	nvic_irq_enable(DMA0_Channel2_IRQn, 0, 1);
+	nvic_irq_enable(DMA0_Channel7_IRQn, 0, 1);
+}
+
+/*!
+	\功能       重新配置总线时钟速度，只能在总线空闲时调用
+	\参数[输入] bus  : 总线序号
+	\参数[输入] speed: 时钟速度
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_speed_set(unsigned char bus, unsigned int speed)
+{
+	unsigned int periph = i2c_hal_tab[bus].periph;
+
+	/* i2c_clock_config只置位不清零，修改前先关闭I2C并清除时钟配置 */
+	i2c_disable(periph);
+	I2C_CKCFG(periph) = 0;
+	/* 快速模式使用16/9占空比，在相同的SCL低电平时间要求下获得更高的速度 */
+	i2c_clock_config(periph, speed, (speed > I2C_SPEED_STD) ? I2C_DTCY_16_9 : I2C_DTCY_2);
+	i2c_enable(periph);
+	i2c_ack_config(periph, I2C_ACK_ENABLE);
+}
+
+/*!
+	\功能       判断总线是否忙，即上一次传输的停止信号是否尚未发送完成
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       1表示忙，0表示空闲
+*/
+int i2c_hal_busy(unsigned char bus)
+{
+	return (SET == i2c_flag_get(i2c_hal_tab[bus].periph, I2C_FLAG_I2CBSY));
+}
+
+/*!
+	\功能       在空闲的总线上启动传输，发送起始信号，后续由中断推进
+	\参数[输入] bus : 总线序号
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_start(unsigned char bus, i2c_xfer * xfer)
+{
+	i2c_hal_bus * hw = &i2c_hal_tab[bus];
+
+	hw->xfer = xfer;
+	hw->phase = I2C_HAL_PHASE_START;
+	hw->seg = 0;
+	hw->dma = 0;
+	i2c_hal_seg_load(hw, &(i2c_seg){.reg = xfer->reg, .pbytes = xfer->pbytes, .count = xfer->count});
+	/* 使能事件、错误和缓冲区中断 */
+	i2c_interrupt_enable(hw->periph, I2C_INT_ERR);
+	i2c_interrupt_enable(hw->periph, I2C_INT_EV);
+	i2c_interrupt_enable(hw->periph, I2C_INT_BUF);
+	/* 向I2C总线上发送起始信号 */
+	i2c_start_on_bus(hw->periph);
+}
+
+/*!
+	\功能       寄存器间隔结束，恢复中断，由TBE中断继续发送数据
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_resume(unsigned char bus)
+{
+	i2c_hal_bus * hw = &i2c_hal_tab[bus];
+
+	hw->gap_done = 1;
+	i2c_interrupt_enable(hw->periph, I2C_INT_BUF);
+	i2c_interrupt_enable(hw->periph, I2C_INT_EV);
+}
+
+/*!
+	\功能       总线空闲或等待期间关闭中断，避免残留的TBE等标志反复进入中断
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_stop(unsigned char bus)
+{
+	i2c_hal_int_disable(i2c_hal_tab[bus].periph);
+}
+
+/*!
+	\功能       总线恢复：从机在传输中途被打断时可能一直拉低SDA，用GPIO发出最多9个SCL时钟
+	            让其送完当前字节并释放SDA，再发出停止信号，最后软件复位I2C；
+	            复位会清除时钟配置，由i2c.c随后调用i2c_hal_speed_set重新使能
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_recover(unsigned char bus)
+{
+	i2c_hal_bus * hw = &i2c_hal_tab[bus];
+
+	i2c_hal_int_disable(hw->periph);
+	if(hw->dma)
+	{
+		i2c_dma_stop(hw);
+	}
+	hw->xfer = 0;
+	hw->phase = I2C_HAL_PHASE_IDLE;
+
+	/* 关闭I2C，SCL和SDA切换为开漏GPIO输出，先输出高电平避免产生多余的边沿 */
+	i2c_disable(hw->periph);
+	gpio_bit_set(hw->gpio, hw->scl | hw->sda);
+	gpio_mode_set(hw->gpio, GPIO_MODE_OUTPUT, GPIO_PUPD_PULLUP, hw->scl | hw->sda);
+
+	/* 发出SCL时钟，直到从机释放SDA，每个时钟周期10us（100kHz） */
+	for(int i=0; (i<9) && (RESET == gpio_input_bit_get(hw->gpio, hw->sda)); i++)
+	{
+		gpio_bit_reset(hw->gpio, hw->scl);
+		delay_us(5);
+		gpio_bit_set(hw->gpio, hw->scl);
+		delay_us(5);
+	}
+	/* 停止信号：SCL高电平期间SDA由低变高 */
+	gpio_bit_reset(hw->gpio, hw->scl);
+	delay_us(5);
+	gpio_bit_reset(hw->gpio, hw->sda);
+	delay_us(5);
+	gpio_bit_set(hw->gpio, hw->scl);
+	delay_us(5);
+	gpio_bit_set(hw->gpio, hw->sda);
+	delay_us(5);
+
+	/* 恢复为I2C复用功能 */
+	gpio_mode_set(hw->gpio, GPIO_MODE_AF, GPIO_PUPD_PULLUP, hw->scl | hw->sda);
+	/* 软件复位清除I2C内部的忙状态，复位会清除所有寄存器，需要重新配置 */
+	i2c_software_reset_config(hw->periph, I2C_SRESET_SET);
+	i2c_software_reset_config(hw->periph, I2C_SRESET_RESET);
+	i2c_mode_addr_config(hw->periph, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, hw->own_addr);
+}
+
+/*!
+	\功能       关中断，用于保护与I2C中断共享的传输队列
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       关中断前的PRIMASK，交给i2c_hal_irq_restore
+*/
+unsigned int i2c_hal_irq_save(void)
+{
+	unsigned int primask = __get_PRIMASK();
+
+	__disable_irq();
+	return primask;
+}
+
+/*!
+	\功能       恢复关中断前的中断状态
+	\参数[输入] state: i2c_hal_irq_save的返回值
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_irq_restore(unsigned int state)
+{
+	__set_PRIMASK(state);
+}
+
+/*!
+	\功能       轮询后端，传输完全由中断推进，GD32后端无需处理
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_poll(void)
+{
+}
+#endif /* BSP_HAL_SIM */
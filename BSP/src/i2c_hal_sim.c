@@ -0,0 +1,1540 @@
+#ifdef BSP_HAL_SIM
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "i2c_hal.h"
+#include "delay.h"
+
+/*
+	PC上的I2C模拟后端：每条总线上挂接模拟从机，按总线时钟速度计算起始、地址、数据、应答和停止信号
+	的线上时间，时间到达后在i2c_hal_poll中结束传输，从而在PC上运行真实的驱动和main.c并测量总线耗时。
+	编译示例：gcc -DBSP_HAL_SIM -IBSP/inc Application/src/main.c 加上BSP/src目录下的全部.c文件 -lm -o demo_sim
+	环境变量I2C_SIM_RUN_MS设置运行时长（毫秒），到时输出传输统计后退出；未设置时一直运行。
+	环境变量I2C_SIM_KEY_BENCH_MS设置按键基准测试的平均间隔（毫秒）：在随机时刻按下'#'键并保持半个间隔，
+	主程序用i2c_sim_key_age_us测量从按下到处理的延迟。
+	环境变量I2C_SIM_UNPLUG设置热插拔测试，格式为"总线:7位地址:拔出时刻:接入时刻"（毫秒），
+	如"0:0x70:1000:2000"在1秒时拔出数码管、2秒时重新接入，用于检查热插拔监视。
+	环境变量I2C_SIM_FAULT设置故障注入，格式为"总线:7位地址:千分比"，如"0:0x60:50"使LED灯5%的传输随机非应答，
+	模拟接触不良，用于检查重试和健康统计。
+	环境变量I2C_SIM_STUCK设置总线挂死测试，格式为"总线:7位地址[:次数[:SCL拉低时长]]"（毫秒），次数默认为1：
+	该从机的传输在中途拉低SDA，不再结束，i2c_hal_busy报告总线忙，直到i2c_hal_recover发出时钟；
+	设置了SCL拉低时长时，从机在此期间同时拉低SCL，其间的恢复无效，下一个传输在启动前等待总线空闲。
+	如"0:0x60:1:8"检查超时、总线恢复、忙等待和重试。
+	模拟从机：PCA9685、HT16K33（数码管和按键）、BH1750、SHT3x、ICM20608、MS523、PCA9557；
+	GD32从机模块（e3、s6、s11）的固件协议未公开，不模拟，探测时非应答。
+*/
+
+/* 模拟从机的地址与驱动使用相同的格式 */
+#define I2C_SIM_ADDR(addr) ((addr) << I2C_ADDR_SHIFT)
+
+/* 模型读写函数的返回值：从机拉低SCL延长的时间（微秒），或从机非应答 */
+#define I2C_SIM_NACK       0xFFFFFFFFu
+
+/* 模拟线上传输阶段 */
+#define I2C_SIM_STAGE_IDLE 0 /* 空闲 */
+#define I2C_SIM_STAGE_REG  1 /* 正在发送从机地址和寄存器地址，结束后进入寄存器间隔 */
+#define I2C_SIM_STAGE_GAP  2 /* 寄存器间隔，等待i2c_hal_resume */
+#define I2C_SIM_STAGE_XFER 3 /* 正在传输，结束后报告状态 */
+#define I2C_SIM_STAGE_STUCK 4 /* 从机拉住总线，传输不再结束，等待i2c_hal_recover */
+
+typedef struct i2c_sim_dev i2c_sim_dev;
+
+/* 模拟从机，write收到主机发送的全部字节（包括寄存器地址），read向主机返回数据 */
+struct i2c_sim_dev
+{
+	unsigned char bus;          /* 总线序号 */
+	unsigned char addr;         /* 从机地址 */
+	unsigned char present;      /* 是否接在总线上 */
+	unsigned int speed;         /* 从机支持的最高时钟速度 */
+	void (*reset)(i2c_sim_dev * dev);
+	unsigned int (*write)(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+	unsigned int (*read)(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+	unsigned char ptr;          /* 寄存器指针 */
+	unsigned char cmd;          /* 正在执行的命令 */
+	unsigned int ready;         /* 命令完成的时间（微秒） */
+	unsigned char regs[256];    /* 寄存器 */
+	unsigned char fifo[64];     /* MS523的FIFO */
+	unsigned char fifo_len;
+	unsigned char resp[20];     /* MS523正在接收的卡片应答，命令完成时写入FIFO */
+	unsigned char resp_len;
+	unsigned char resp_bits;    /* 应答最后一个字节的有效位数，0表示8位 */
+	unsigned char resp_irq;     /* 命令完成时置位的ComIrqReg位 */
+};
+
+/* 模拟总线状态 */
+typedef struct
+{
+	i2c_xfer * xfer;            /* 正在进行的传输 */
+	i2c_sim_dev * dev;          /* 被寻址的从机，不存在时为NULL */
+	unsigned char stage;        /* 线上传输阶段 */
+	unsigned char status;       /* 传输结束时报告的状态 */
+	unsigned int end;           /* 当前阶段结束的时间（微秒） */
+	unsigned int speed;         /* 当前时钟速度，软件复位后为0，直到重新配置 */
+	unsigned char sda_low;      /* 从机拉低SDA，总线忙 */
+	unsigned int scl_release;   /* 从机释放SCL的时间（微秒），此前的恢复时钟发不出去 */
+}i2c_sim_bus;
+
+static i2c_sim_bus i2c_sim_bus_tab[sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int)];
+/* 模拟中断屏蔽，置1时i2c_hal_poll不推进传输 */
+static unsigned int i2c_sim_irq_mask = 0;
+/* 运行时长（毫秒），0表示一直运行 */
+static unsigned int i2c_sim_run_ms = 0;
+/* 按键基准测试的平均间隔（毫秒），0表示不测试；下一次按下或松开的时间（毫秒） */
+static unsigned int i2c_sim_key_bench_ms = 0;
+static unsigned int i2c_sim_key_bench_next = 0;
+static unsigned char i2c_sim_key_bench_down = 0;
+/* 热插拔测试的从机和拔出、接入的时刻（毫秒），i2c_sim_unplug_stage为已执行的步数 */
+static unsigned int i2c_sim_unplug_bus = 0;
+static unsigned int i2c_sim_unplug_addr = 0;
+static unsigned int i2c_sim_unplug_ms[2] = {0, 0};
+static unsigned char i2c_sim_unplug_stage = 2;
+/* 故障注入的从机和随机非应答的千分比 */
+static unsigned int i2c_sim_fault_bus = 0;
+static unsigned int i2c_sim_fault_addr = 0;
+static unsigned int i2c_sim_fault_permille = 0;
+/* 总线挂死测试的从机、剩余挂死次数和SCL拉低时长（毫秒），以及挂死、恢复和释放总线的次数 */
+static unsigned int i2c_sim_stuck_bus = 0;
+static unsigned int i2c_sim_stuck_addr = 0;
+static unsigned int i2c_sim_stuck_count = 0;
+static unsigned int i2c_sim_stuck_scl_ms = 0;
+static unsigned int i2c_sim_stuck_stat[3] = {0, 0, 0};
+
+/* 模拟的外部输入 */
+static unsigned char i2c_sim_keys[6];                                /* HT16K33按键RAM */
+static unsigned int i2c_sim_key_time = 0;                            /* 最近一次按下的时间（微秒） */
+static unsigned char i2c_sim_card_uid[4];                            /* NFC卡号 */
+static unsigned char i2c_sim_card_present = 0;                       /* 天线范围内是否有卡 */
+static unsigned char i2c_sim_card_halted = 0;                        /* 卡片是否已休眠 */
+static unsigned char i2c_sim_card_auth = 0;                          /* 卡片是否已通过认证 */
+static int i2c_sim_card_write_block = -1;                            /* 等待写入数据的块地址 */
+static unsigned char i2c_sim_card_mem[64][16];                       /* 卡片存储区（S50，64块） */
+static unsigned int i2c_sim_lux = 300;                               /* 光照强度（lx） */
+static float i2c_sim_temp = 25.0f;                                   /* 温度（℃） */
+static float i2c_sim_humi = 50.0f;                                   /* 湿度（%RH） */
+static short i2c_sim_accel[3] = {0, 0, 1000};                        /* 加速度（mg） */
+static unsigned char i2c_sim_ir = 0;                                 /* 人体红外状态 */
+
+static void i2c_sim_pca9685_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_pca9685_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_pca9685_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_ht16k33_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_ht16k33_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_ht16k33_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_bh1750_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_bh1750_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_bh1750_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_sht3x_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_sht3x_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_sht3x_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_icm20608_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_icm20608_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_icm20608_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_ms523_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_ms523_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_ms523_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+static void i2c_sim_pca9557_reset(i2c_sim_dev * dev);
+static unsigned int i2c_sim_pca9557_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count);
+static unsigned int i2c_sim_pca9557_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count);
+
+#define I2C_SIM_MODEL(name) .reset = i2c_sim_##name##_reset, .write = i2c_sim_##name##_write, .read = i2c_sim_##name##_read
+
+/* 模拟从机表：显示、按键和NFC在I2C0上，风扇和传感器在I2C1上 */
+#define I2C_SIM_KEY        2 /* 按键HT16K33在表中的下标 */
+static i2c_sim_dev i2c_sim_dev_tab[] =
+{
+	{.bus = 0, .addr = I2C_SIM_ADDR(0x60), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(pca9685)},  /* e1 LED灯 */
+	{.bus = 0, .addr = I2C_SIM_ADDR(0x70), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(ht16k33)},  /* e1 数码管 */
+	{.bus = 0, .addr = I2C_SIM_ADDR(0x74), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(ht16k33)},  /* s1 按键 */
+	{.bus = 0, .addr = I2C_SIM_ADDR(0x28), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(ms523)},    /* s5 NFC */
+	{.bus = 1, .addr = I2C_SIM_ADDR(0x64), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(pca9685)},  /* e2 风扇 */
+	{.bus = 1, .addr = I2C_SIM_ADDR(0x23), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(bh1750)},   /* s2 光照强度 */
+	{.bus = 1, .addr = I2C_SIM_ADDR(0x44), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(sht3x)},    /* s2 温湿度 */
+	{.bus = 1, .addr = I2C_SIM_ADDR(0x68), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(icm20608)}, /* s2 加速度&角速度 */
+	{.bus = 1, .addr = I2C_SIM_ADDR(0x18), .present = 1, .speed = I2C_SPEED_FAST, I2C_SIM_MODEL(pca9557)},  /* s7 人体红外 */
+};
+
+/*!
+	\功能       计算指定位数在总线上的传输时间
+	\参数[输入] speed: 时钟速度
+	\参数[输入] bits : 时钟个数
+	\参数[输出] 无
+	\返回       时间（微秒），向上取整
+*/
+static unsigned int i2c_sim_bits_us(unsigned int speed, unsigned int bits)
+{
+	return (bits * 1000000 + speed - 1) / speed;
+}
+
+/*!
+	\功能       查找总线上的模拟从机
+	\参数[输入] bus : 总线序号
+	\参数[输入] addr: 从机地址
+	\参数[输出] 无
+	\返回       模拟从机，不存在时返回NULL
+*/
+static i2c_sim_dev * i2c_sim_dev_find(unsigned char bus, unsigned char addr)
+{
+	for(int i=0; i<sizeof(i2c_sim_dev_tab)/sizeof(i2c_sim_dev); i++)
+	{
+		if((i2c_sim_dev_tab[i].bus == bus) && (i2c_sim_dev_tab[i].addr == addr))
+		{
+			return &i2c_sim_dev_tab[i];
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       PCA9685上电复位：睡眠、寄存器地址不自动递增，所有通道完全关闭
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_pca9685_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->regs[0x00] = 0x11;
+	dev->regs[0x01] = 0x04;
+	for(int i=0; i<16; i++)
+	{
+		dev->regs[0x09 + 4*i] = 0x10;
+	}
+	dev->regs[0xFE] = 0x1E;
+	dev->ptr = 0;
+}
+
+/*!
+	\功能       PCA9685写：第一个字节为寄存器地址，MODE1的AI位置1时地址自动递增
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_pca9685_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+	dev->ptr = pbytes[0];
+	for(int i=1; i<count; i++)
+	{
+		dev->regs[dev->ptr] = pbytes[i];
+		if(dev->regs[0x00] & 0x20)
+		{
+			dev->ptr = (dev->ptr == 0x45) ? 0x00 : dev->ptr + 1;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       PCA9685读：从寄存器指针开始读取
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_pca9685_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[dev->ptr];
+		if(dev->regs[0x00] & 0x20)
+		{
+			dev->ptr = (dev->ptr == 0x45) ? 0x00 : dev->ptr + 1;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       HT16K33上电复位：振荡器和显示关闭，显示RAM清零
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_ht16k33_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->regs[0x20] = 0x20; /* 系统设置 */
+	dev->regs[0x80] = 0x80; /* 显示设置 */
+	dev->regs[0xE0] = 0xEF; /* 亮度 */
+	dev->ptr = 0;
+}
+
+/*!
+	\功能       HT16K33写：0x0X为显示RAM地址，其后的数据依次写入显示RAM；0x2X、0x8X、0xEX为设置命令；
+	            0x4X为按键RAM地址
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_ht16k33_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+	switch(pbytes[0] & 0xF0)
+	{
+		case 0x00:
+			dev->ptr = pbytes[0];
+			for(int i=1; i<count; i++)
+			{
+				dev->regs[dev->ptr] = pbytes[i];
+				dev->ptr = (dev->ptr + 1) & 0x0F;
+			}
+			break;
+		case 0x20:
+		case 0x80:
+		case 0xA0:
+		case 0xE0:
+			dev->regs[pbytes[0] & 0xF0] = pbytes[0];
+			break;
+		default:
+			dev->ptr = pbytes[0];
+			break;
+	}
+	return 0;
+}
+
+/*!
+	\功能       HT16K33读：从显示RAM或按键RAM读取，按键从机的按键RAM反映当前按下的键
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_ht16k33_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	if(dev == &i2c_sim_dev_tab[I2C_SIM_KEY])
+	{
+		memcpy(&dev->regs[0x40], i2c_sim_keys, sizeof(i2c_sim_keys));
+	}
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[dev->ptr];
+		if(dev->ptr < 0x10)
+		{
+			dev->ptr = (dev->ptr + 1) & 0x0F;
+		}
+		else if((dev->ptr >= 0x40) && (dev->ptr < 0x45))
+		{
+			dev->ptr ++;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       BH1750上电复位：断电状态，数据寄存器为0
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_bh1750_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->cmd = 0;
+}
+
+/*!
+	\功能       BH1750写：每个字节为一条命令，测量命令在测量时间后才更新数据寄存器，
+	            高分辨率模式120ms，低分辨率模式16ms；重复发送测量命令会重新开始测量
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_bh1750_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	for(int i=0; i<count; i++)
+	{
+		switch(pbytes[i])
+		{
+			case 0x00: /* 断电 */
+				dev->cmd = 0;
+				dev->regs[0x10] = 0;
+				break;
+			case 0x01: /* 上电 */
+				dev->regs[0x10] = 1;
+				break;
+			case 0x07: /* 复位数据寄存器 */
+				dev->regs[0] = 0;
+				dev->regs[1] = 0;
+				break;
+			case 0x10: case 0x11: case 0x20: case 0x21: /* 高分辨率测量 */
+				dev->cmd = pbytes[i];
+				dev->ready = delay_deadline(120000);
+				break;
+			case 0x13: case 0x23: /* 低分辨率测量 */
+				dev->cmd = pbytes[i];
+				dev->ready = delay_deadline(16000);
+				break;
+			default:
+				break;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       BH1750读：返回最近一次完成的测量结果（光照强度×1.2）
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_bh1750_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	unsigned int value = i2c_sim_lux * 6 / 5;
+
+	if(dev->cmd && delay_expired(dev->ready))
+	{
+		if(value > 0xFFFF)
+		{
+			value = 0xFFFF;
+		}
+		dev->regs[0] = value >> 8;
+		dev->regs[1] = value;
+		if(dev->cmd & 0x20)
+		{
+			/* 单次测量完成后自动断电 */
+			dev->cmd = 0;
+		}
+	}
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[i & 0x01];
+	}
+	return 0;
+}
+
+/*!
+	\功能       SHT3x的CRC8校验，多项式0x31，初值0xFF
+	\参数[输入] pbytes: 数据
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       校验值
+*/
+static unsigned char i2c_sim_sht3x_crc(const unsigned char * pbytes, unsigned int count)
+{
+	unsigned char crc = 0xFF;
+
+	for(int i=0; i<count; i++)
+	{
+		crc ^= pbytes[i];
+		for(int j=0; j<8; j++)
+		{
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+/*!
+	\功能       SHT3x上电复位：空闲，没有测量结果
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_sht3x_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->cmd = 0;
+	dev->ready = delay_time_us();
+}
+
+/*!
+	\功能       SHT3x写：两个字节为一条命令；单次测量的时间为高/中/低重复性15ms/6ms/4ms，
+	            0x2C开头的命令在测量完成前读取时拉低SCL等待，0x24开头的命令非应答；软复位需要1.5ms
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0，或测量/复位期间返回I2C_SIM_NACK
+*/
+static unsigned int i2c_sim_sht3x_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	unsigned short cmd;
+	unsigned short raw;
+
+	if(!delay_expired(dev->ready))
+	{
+		return I2C_SIM_NACK;
+	}
+	if(count < 2)
+	{
+		return 0;
+	}
+	cmd = (pbytes[0] << 8) | pbytes[1];
+	if(cmd == 0x30A2)
+	{
+		dev->cmd = 0;
+		dev->ready = delay_deadline(1500);
+		return 0;
+	}
+	if((pbytes[0] != 0x2C) && (pbytes[0] != 0x24))
+	{
+		return 0;
+	}
+	dev->cmd = pbytes[0];
+	switch(pbytes[1])
+	{
+		case 0x06: case 0x00: dev->ready = delay_deadline(15000); break;
+		case 0x0D: case 0x0B: dev->ready = delay_deadline(6000); break;
+		default:              dev->ready = delay_deadline(4000); break;
+	}
+	raw = (i2c_sim_temp + 45.0f) / 175.0f * 65535.0f;
+	dev->regs[0] = raw >> 8;
+	dev->regs[1] = raw;
+	dev->regs[2] = i2c_sim_sht3x_crc(&dev->regs[0], 2);
+	raw = i2c_sim_humi / 100.0f * 65535.0f;
+	dev->regs[3] = raw >> 8;
+	dev->regs[4] = raw;
+	dev->regs[5] = i2c_sim_sht3x_crc(&dev->regs[3], 2);
+	return 0;
+}
+
+/*!
+	\功能       SHT3x读：返回温度、湿度及其CRC共6个字节，读取后测量结果失效
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       拉低SCL等待测量完成的时间，没有测量结果时返回I2C_SIM_NACK
+*/
+static unsigned int i2c_sim_sht3x_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	unsigned int stretch = 0;
+
+	if(dev->cmd == 0)
+	{
+		return I2C_SIM_NACK;
+	}
+	if(!delay_expired(dev->ready))
+	{
+		if(dev->cmd != 0x2C)
+		{
+			return I2C_SIM_NACK;
+		}
+		stretch = dev->ready - delay_time_us();
+	}
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = (i < 6) ? dev->regs[i] : 0xFF;
+	}
+	dev->cmd = 0;
+	return stretch;
+}
+
+/*!
+	\功能       ICM20608上电复位：睡眠，WHO_AM_I为0xAF
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_icm20608_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->regs[0x6B] = 0x40;
+	dev->regs[0x75] = 0xAF;
+	dev->ptr = 0;
+}
+
+/*!
+	\功能       ICM20608写：第一个字节为寄存器地址，地址自动递增；PWR_MGMT_1的DEVICE_RESET位使从机复位
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_icm20608_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+	dev->ptr = pbytes[0] & 0x7F;
+	for(int i=1; i<count; i++)
+	{
+		if((dev->ptr == 0x6B) && (pbytes[i] & 0x80))
+		{
+			i2c_sim_icm20608_reset(dev);
+			return 0;
+		}
+		dev->regs[dev->ptr] = pbytes[i];
+		dev->ptr = (dev->ptr + 1) & 0x7F;
+	}
+	return 0;
+}
+
+/*!
+	\功能       ICM20608读：未睡眠时按ACCEL_CONFIG的量程把模拟加速度换算到ACCEL_XOUT_H~ACCEL_ZOUT_L
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_icm20608_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	int lsb = 16384 >> ((dev->regs[0x1C] >> 3) & 0x03);
+	short value;
+
+	if(!(dev->regs[0x6B] & 0x40))
+	{
+		for(int i=0; i<3; i++)
+		{
+			value = i2c_sim_accel[i] * lsb / 1000;
+			dev->regs[0x3B + 2*i] = value >> 8;
+			dev->regs[0x3C + 2*i] = value;
+		}
+		/* 温度25℃ */
+		dev->regs[0x41] = 0;
+		dev->regs[0x42] = 25;
+	}
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[dev->ptr];
+		dev->ptr = (dev->ptr + 1) & 0x7F;
+	}
+	return 0;
+}
+
+/*!
+	\功能       ISO14443A的CRC_A，初值0x6363
+	\参数[输入] pbytes: 数据
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       校验值，低字节在前发送
+*/
+static unsigned short i2c_sim_crc_a(const unsigned char * pbytes, unsigned int count)
+{
+	unsigned short crc = 0x6363;
+
+	for(int i=0; i<count; i++)
+	{
+		unsigned char b = pbytes[i] ^ (crc & 0xFF);
+
+		b ^= b << 4;
+		crc = (crc >> 8) ^ (b << 8) ^ (b << 3) ^ (b >> 4);
+	}
+	return crc;
+}
+
+/*!
+	\功能       MS523上电复位：寄存器恢复默认值，FIFO清空
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_ms523_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->regs[0x01] = 0x20; /* CommandReg */
+	dev->regs[0x02] = 0x80; /* ComIEnReg */
+	dev->regs[0x04] = 0x14; /* ComIrqReg */
+	dev->regs[0x0B] = 0x08; /* WaterLevelReg */
+	dev->regs[0x0C] = 0x10; /* ControlReg */
+	dev->regs[0x11] = 0x3F; /* ModeReg */
+	dev->regs[0x14] = 0x80; /* TxControlReg */
+	dev->regs[0x16] = 0x10; /* TxSelReg */
+	dev->regs[0x17] = 0x84; /* RxSelReg */
+	dev->regs[0x18] = 0x84; /* RxThresholdReg */
+	dev->regs[0x19] = 0x4D; /* DemodReg */
+	dev->regs[0x1F] = 0xEB; /* SerialSpeedReg */
+	dev->regs[0x24] = 0x26; /* ModWidthReg */
+	dev->regs[0x26] = 0x48; /* RFCfgReg */
+	dev->regs[0x27] = 0x88; /* GsNReg */
+	dev->regs[0x28] = 0x20; /* CWGsCfgReg */
+	dev->regs[0x29] = 0x20; /* ModGsCfgReg */
+	dev->regs[0x37] = 0x92; /* VersionReg */
+	dev->fifo_len = 0;
+	dev->resp_len = 0;
+	dev->resp_irq = 0;
+	dev->cmd = 0;
+	dev->ready = delay_time_us();
+}
+
+/*!
+	\功能       计算MS523定时器溢出时间，即卡片无应答时命令结束的时间
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       溢出时间（微秒）
+*/
+static unsigned int i2c_sim_ms523_timeout(i2c_sim_dev * dev)
+{
+	unsigned int prescaler = ((dev->regs[0x2A] & 0x0F) << 8) | dev->regs[0x2B];
+	unsigned int reload = (dev->regs[0x2C] << 8) | dev->regs[0x2D];
+
+	/* 定时器频率为13.56MHz/(2*TPrescaler+1) */
+	return (unsigned long long)(reload + 1) * (2 * prescaler + 1) * 1000000 / 13560000;
+}
+
+/*!
+	\功能       MS523与卡片交换数据：根据FIFO中的帧生成卡片应答，在射频传输时间后写入FIFO
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_ms523_transceive(i2c_sim_dev * dev)
+{
+	unsigned char * frame = dev->fifo;
+	unsigned char len = dev->fifo_len;
+	unsigned char * resp = dev->resp;
+	unsigned short crc;
+
+	dev->fifo_len = 0;
+	dev->resp_len = 0;
+	dev->resp_bits = 0;
+	dev->regs[0x06] = 0; /* ErrorReg */
+
+	if(i2c_sim_card_present && (len >= 1) && ((frame[0] == 0x52) || ((frame[0] == 0x26) && !i2c_sim_card_halted)))
+	{
+		/* REQA/WUPA：ATQA，Mifare One S50 */
+		i2c_sim_card_halted = 0;
+		resp[0] = 0x04;
+		resp[1] = 0x00;
+		dev->resp_len = 2;
+	}
+	else if(i2c_sim_card_present && !i2c_sim_card_halted && (len == 2) && (frame[0] == 0x93) && (frame[1] == 0x20))
+	{
+		/* 防冲突：卡号和BCC */
+		memcpy(resp, i2c_sim_card_uid, 4);
+		resp[4] = resp[0] ^ resp[1] ^ resp[2] ^ resp[3];
+		dev->resp_len = 5;
+	}
+	else if(i2c_sim_card_present && !i2c_sim_card_halted && (len == 9) && (frame[0] == 0x93) && (frame[1] == 0x70) &&
+	        !memcmp(&frame[2], i2c_sim_card_uid, 4))
+	{
+		/* 选卡：SAK和CRC */
+		resp[0] = 0x08;
+		crc = i2c_sim_crc_a(resp, 1);
+		resp[1] = crc;
+		resp[2] = crc >> 8;
+		dev->resp_len = 3;
+	}
+	else if(i2c_sim_card_present && i2c_sim_card_auth && (len == 4) && (frame[0] == 0x30) && (frame[1] < 64))
+	{
+		/* 读块：16字节数据和CRC */
+		memcpy(resp, i2c_sim_card_mem[frame[1]], 16);
+		crc = i2c_sim_crc_a(resp, 16);
+		resp[16] = crc;
+		resp[17] = crc >> 8;
+		dev->resp_len = 18;
+	}
+	else if(i2c_sim_card_present && i2c_sim_card_auth && (len == 4) && (frame[0] == 0xA0) && (frame[1] < 64))
+	{
+		/* 写块第一步：4位ACK */
+		i2c_sim_card_write_block = frame[1];
+		resp[0] = 0x0A;
+		dev->resp_len = 1;
+		dev->resp_bits = 4;
+	}
+	else if(i2c_sim_card_present && (i2c_sim_card_write_block >= 0) && (len == 18))
+	{
+		/* 写块第二步：写入16字节数据，4位ACK */
+		memcpy(i2c_sim_card_mem[i2c_sim_card_write_block], frame, 16);
+		i2c_sim_card_write_block = -1;
+		resp[0] = 0x0A;
+		dev->resp_len = 1;
+		dev->resp_bits = 4;
+	}
+	else if(i2c_sim_card_present && (len >= 2) && (frame[0] == 0x50))
+	{
+		/* 休眠：卡片不应答 */
+		i2c_sim_card_halted = 1;
+		i2c_sim_card_auth = 0;
+	}
+
+	if(dev->resp_len)
+	{
+		/* 帧间隔和106kbps下每字节约94us，读块约2ms */
+		dev->resp_irq = 0x30;
+		dev->ready = delay_deadline(500 + (len + dev->resp_len) * 94);
+	}
+	else
+	{
+		/* 没有卡片应答，等待定时器溢出 */
+		dev->resp_irq = 0x01;
+		dev->ready = delay_deadline(i2c_sim_ms523_timeout(dev));
+	}
+}
+
+/*!
+	\功能       MS523执行命令
+	\参数[输入] dev: 模拟从机
+	\参数[输入] cmd: 命令
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_ms523_command(i2c_sim_dev * dev, unsigned char cmd)
+{
+	unsigned short crc;
+
+	dev->cmd = cmd & 0x0F;
+	dev->resp_irq = 0;
+	switch(dev->cmd)
+	{
+		case 0x0F: /* PCD_RESETPHASE */
+			i2c_sim_ms523_reset(dev);
+			i2c_sim_card_auth = 0;
+			break;
+		case 0x03: /* PCD_CALCCRC */
+			crc = i2c_sim_crc_a(dev->fifo, dev->fifo_len);
+			dev->regs[0x22] = crc;      /* CRCResultRegL */
+			dev->regs[0x21] = crc >> 8; /* CRCResultRegM */
+			dev->regs[0x05] |= 0x04;    /* DivIrqReg CRCIRq */
+			dev->fifo_len = 0;
+			break;
+		case 0x0E: /* PCD_AUTHENT：FIFO中为认证模式、块地址、6字节密钥和4字节卡号 */
+			if(i2c_sim_card_present && !i2c_sim_card_halted && (dev->fifo_len >= 12) && !memcmp(&dev->fifo[8], i2c_sim_card_uid, 4))
+			{
+				i2c_sim_card_auth = 1;
+				dev->regs[0x08] |= 0x08; /* Status2Reg MFCrypto1On */
+				dev->resp_irq = 0x10;
+				dev->ready = delay_deadline(1000);
+			}
+			else
+			{
+				dev->resp_irq = 0x01;
+				dev->ready = delay_deadline(i2c_sim_ms523_timeout(dev));
+			}
+			dev->fifo_len = 0;
+			break;
+		default:
+			/* PCD_TRANSCEIVE等待BitFramingReg的StartSend位 */
+			break;
+	}
+	dev->regs[0x01] = (dev->regs[0x01] & 0xF0) | dev->cmd;
+}
+
+/*!
+	\功能       MS523命令完成时把卡片应答写入FIFO并置位中断标志
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_ms523_update(i2c_sim_dev * dev)
+{
+	if(dev->resp_irq && delay_expired(dev->ready))
+	{
+		memcpy(dev->fifo, dev->resp, dev->resp_len);
+		dev->fifo_len = dev->resp_len;
+		dev->regs[0x0C] = (dev->regs[0x0C] & ~0x07) | dev->resp_bits;
+		dev->regs[0x04] |= dev->resp_irq;
+		dev->resp_irq = 0;
+		dev->resp_len = 0;
+		if(dev->cmd != 0x0C)
+		{
+			dev->cmd = 0;
+			dev->regs[0x01] &= 0xF0;
+		}
+	}
+}
+
+/*!
+	\功能       MS523写：第一个字节为寄存器地址，除FIFODataReg外地址自动递增
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_ms523_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	unsigned char value;
+
+	if(count == 0)
+	{
+		return 0;
+	}
+	i2c_sim_ms523_update(dev);
+	dev->ptr = pbytes[0] & 0x3F;
+	for(int i=1; i<count; i++)
+	{
+		value = pbytes[i];
+		switch(dev->ptr)
+		{
+			case 0x01: /* CommandReg */
+				dev->regs[0x01] = value & 0x30;
+				i2c_sim_ms523_command(dev, value);
+				break;
+			case 0x04: /* ComIrqReg：Set1位为1时置位，否则清零 */
+			case 0x05: /* DivIrqReg */
+				if(value & 0x80)
+				{
+					dev->regs[dev->ptr] |= value & 0x7F;
+				}
+				else
+				{
+					dev->regs[dev->ptr] &= ~value;
+				}
+				break;
+			case 0x09: /* FIFODataReg */
+				if(dev->fifo_len < sizeof(dev->fifo))
+				{
+					dev->fifo[dev->fifo_len++] = value;
+				}
+				break;
+			case 0x0A: /* FIFOLevelReg：FlushBuffer */
+				if(value & 0x80)
+				{
+					dev->fifo_len = 0;
+				}
+				break;
+			case 0x0D: /* BitFramingReg：StartSend */
+				dev->regs[0x0D] = value & 0x7F;
+				if((value & 0x80) && (dev->cmd == 0x0C))
+				{
+					i2c_sim_ms523_transceive(dev);
+				}
+				break;
+			case 0x06: case 0x07: case 0x37: /* 只读寄存器 */
+				break;
+			default:
+				dev->regs[dev->ptr] = value;
+				break;
+		}
+		if(dev->ptr != 0x09)
+		{
+			dev->ptr = (dev->ptr + 1) & 0x3F;
+		}
+	}
+	return 0;
+}
+
+/*!
+	\功能       MS523读：FIFODataReg依次读出FIFO，FIFOLevelReg返回FIFO中的字节数
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_ms523_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	i2c_sim_ms523_update(dev);
+	for(int i=0; i<count; i++)
+	{
+		if(dev->ptr == 0x09)
+		{
+			pbytes[i] = dev->fifo_len ? dev->fifo[0] : 0;
+			if(dev->fifo_len)
+			{
+				memmove(dev->fifo, dev->fifo + 1, --dev->fifo_len);
+			}
+			continue;
+		}
+		pbytes[i] = (dev->ptr == 0x0A) ? dev->fifo_len : dev->regs[dev->ptr];
+		dev->ptr = (dev->ptr + 1) & 0x3F;
+	}
+	return 0;
+}
+
+/*!
+	\功能       PCA9557上电复位：输出寄存器0x00，IO4~IO7极性反转，全部为输入
+	\参数[输入] dev: 模拟从机
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_pca9557_reset(i2c_sim_dev * dev)
+{
+	memset(dev->regs, 0, sizeof(dev->regs));
+	dev->regs[0x02] = 0xF0;
+	dev->regs[0x03] = 0xFF;
+	dev->ptr = 0;
+}
+
+/*!
+	\功能       PCA9557写：第一个字节为命令字节（寄存器地址），地址不递增
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] pbytes: 主机发送的字节
+	\参数[输入] count : 字节个数
+	\参数[输出] 无
+	\返回       0
+*/
+static unsigned int i2c_sim_pca9557_write(i2c_sim_dev * dev, const unsigned char * pbytes, unsigned int count)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+	dev->ptr = pbytes[0] & 0x03;
+	for(int i=1; (i<count) && dev->ptr; i++)
+	{
+		dev->regs[dev->ptr] = pbytes[i];
+	}
+	return 0;
+}
+
+/*!
+	\功能       PCA9557读：输入寄存器为引脚电平异或极性反转，IO0接人体红外，其余引脚上拉
+	\参数[输入] dev   : 模拟从机
+	\参数[输入] count : 字节个数
+	\参数[输出] pbytes: 返回给主机的字节
+	\返回       0
+*/
+static unsigned int i2c_sim_pca9557_read(i2c_sim_dev * dev, unsigned char * pbytes, unsigned int count)
+{
+	dev->regs[0x00] = (0xFE | (i2c_sim_ir & 0x01)) ^ dev->regs[0x02];
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[dev->ptr];
+	}
+	return 0;
+}
+
+/*!
+	\功能       从机执行一次完整的传输，计算线上时间
+	\参数[输入] sim : 模拟总线状态
+	\参数[输入] bits: 已经在线上的时钟个数（起始信号和地址）
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_exec(i2c_sim_bus * sim, unsigned int bits)
+{
+	i2c_xfer * xfer = sim->xfer;
+	i2c_sim_dev * dev = sim->dev;
+	unsigned char wire[256];
+	unsigned int count = 0;
+	unsigned int stretch = 0;
+	unsigned int wait = 0;
+
+	sim->status = I2C_XFER_DONE;
+	if(xfer->flags & I2C_XFER_REG)
+	{
+		wire[count++] = xfer->reg;
+	}
+	if(!(xfer->flags & I2C_XFER_READ))
+	{
+		memcpy(&wire[count], xfer->pbytes, xfer->count);
+		count += xfer->count;
+	}
+
+	if(count || !(xfer->flags & I2C_XFER_READ))
+	{
+		/* 主机发送阶段 */
+		stretch = dev->write(dev, wire, count);
+		bits += 9 * count;
+	}
+	if((stretch != I2C_SIM_NACK) && (xfer->flags & I2C_XFER_READ))
+	{
+		if(xfer->flags & I2C_XFER_REG)
+		{
+			/* 重复起始信号和读地址 */
+			bits += 1 + 9;
+		}
+		stretch = dev->read(dev, xfer->pbytes, xfer->count);
+		if(stretch != I2C_SIM_NACK)
+		{
+			bits += 9 * xfer->count;
+		}
+	}
+	if(xfer->seg_num)
+	{
+		/* 向量写的每一段都有从机间隔，计入等待时间 */
+		wait = xfer->gap;
+	}
+	for(int i=0; (stretch != I2C_SIM_NACK) && (i<xfer->seg_num); i++)
+	{
+		/* 向量写的后续段：重复起始信号、从机地址、寄存器地址和数据 */
+		wait += stretch + xfer->gap;
+		wire[0] = xfer->segs[i].reg;
+		memcpy(&wire[1], xfer->segs[i].pbytes, xfer->segs[i].count);
+		stretch = dev->write(dev, wire, xfer->segs[i].count + 1);
+		bits += 1 + 9 + 9 * (xfer->segs[i].count + 1);
+	}
+	if(stretch == I2C_SIM_NACK)
+	{
+		sim->status = I2C_XFER_NACK;
+		stretch = 0;
+	}
+	/* 停止信号 */
+	bits += 1;
+	sim->end = delay_deadline(i2c_sim_bits_us(sim->speed, bits) + wait + stretch);
+	sim->stage = I2C_SIM_STAGE_XFER;
+}
+
+/*!
+	\功能       输出一行传输统计到标准输出
+	\参数[输入] str: 字符串
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_output(const char * str)
+{
+	fputs(str, stdout);
+}
+
+/*!
+	\功能       退出时输出传输统计
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_exit(void)
+{
+	i2c_trace_dump(i2c_sim_output, 0);
+	i2c_placement_dump(i2c_sim_output);
+	i2c_health_dump(i2c_sim_output);
+	if(i2c_sim_stuck_stat[0])
+	{
+		printf("i2c sim stuck: %u hangs, %u recovers, %u released\n",
+		       i2c_sim_stuck_stat[0], i2c_sim_stuck_stat[1], i2c_sim_stuck_stat[2]);
+	}
+	fflush(stdout);
+}
+
+/*!
+	\功能       模拟从机上电复位，读取运行时长
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_init(void)
+{
+	const char * run_ms = getenv("I2C_SIM_RUN_MS");
+	const char * key_bench_ms = getenv("I2C_SIM_KEY_BENCH_MS");
+	const char * unplug = getenv("I2C_SIM_UNPLUG");
+	const char * fault = getenv("I2C_SIM_FAULT");
+	const char * stuck = getenv("I2C_SIM_STUCK");
+
+	i2c_sim_bus_tab[0].speed = I2C0_SPEED;
+	i2c_sim_bus_tab[1].speed = I2C1_SPEED;
+	for(int i=0; i<sizeof(i2c_sim_dev_tab)/sizeof(i2c_sim_dev); i++)
+	{
+		i2c_sim_dev_tab[i].reset(&i2c_sim_dev_tab[i]);
+	}
+	if(run_ms)
+	{
+		i2c_sim_run_ms = strtoul(run_ms, 0, 0);
+	}
+	if(key_bench_ms)
+	{
+		i2c_sim_key_bench_ms = strtoul(key_bench_ms, 0, 0);
+		i2c_sim_key_bench_next = i2c_sim_key_bench_ms;
+	}
+	if(unplug && (sscanf(unplug, "%u:%i:%u:%u", &i2c_sim_unplug_bus, &i2c_sim_unplug_addr,
+	                     &i2c_sim_unplug_ms[0], &i2c_sim_unplug_ms[1]) == 4))
+	{
+		i2c_sim_unplug_stage = 0;
+	}
+	if(fault && (sscanf(fault, "%u:%i:%u", &i2c_sim_fault_bus, &i2c_sim_fault_addr, &i2c_sim_fault_permille) == 3))
+	{
+		i2c_sim_fault_addr = I2C_SIM_ADDR(i2c_sim_fault_addr);
+	}
+	if(stuck)
+	{
+		unsigned int bus, addr, count = 1, scl_ms = 0;
+
+		if(sscanf(stuck, "%u:%i:%u:%u", &bus, &addr, &count, &scl_ms) >= 2)
+		{
+			i2c_sim_stuck_set(bus, I2C_SIM_ADDR(addr), count, scl_ms);
+		}
+	}
+	atexit(i2c_sim_exit);
+}
+
+/*!
+	\功能       设置总线时钟速度
+	\参数[输入] bus  : 总线序号
+	\参数[输入] speed: 时钟速度
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_speed_set(unsigned char bus, unsigned int speed)
+{
+	i2c_sim_bus_tab[bus].speed = speed;
+}
+
+/*!
+	\功能       判断总线是否忙：模拟总线的停止信号在传输结束时已完成，只有从机拉低SDA时为忙
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       1表示忙，0表示空闲
+*/
+int i2c_hal_busy(unsigned char bus)
+{
+	return i2c_sim_bus_tab[bus].sda_low;
+}
+
+/*!
+	\功能       启动传输：寻址从机，不存在的从机在地址字节后非应答，从机不支持当前速度时报告总线错误
+	\参数[输入] bus : 总线序号
+	\参数[输入] xfer: I2C传输描述
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_start(unsigned char bus, i2c_xfer * xfer)
+{
+	i2c_sim_bus * sim = &i2c_sim_bus_tab[bus];
+	i2c_sim_dev * dev = i2c_sim_dev_find(bus, xfer->addr);
+	/* 起始信号和地址字节（含应答位） */
+	unsigned int bits = 1 + 9;
+
+	sim->xfer = xfer;
+	sim->dev = (dev && dev->present) ? dev : 0;
+	if(sim->dev && i2c_sim_fault_permille && (bus == i2c_sim_fault_bus) && (xfer->addr == i2c_sim_fault_addr) &&
+	   (rand() % 1000 < i2c_sim_fault_permille))
+	{
+		/* 故障注入：接触不良的从机在地址字节后非应答 */
+		sim->dev = 0;
+	}
+	if(sim->speed == 0)
+	{
+		/* 软件复位后未重新配置时钟，外设发不出起始信号 */
+		sim->status = I2C_XFER_BERR;
+		sim->end = delay_deadline(0);
+		sim->stage = I2C_SIM_STAGE_XFER;
+	}
+	else if(sim->dev && i2c_sim_stuck_count && (bus == i2c_sim_stuck_bus) && (xfer->addr == i2c_sim_stuck_addr))
+	{
+		/* 总线挂死：从机在传输中途拉低SDA（可能同时拉低SCL），传输不再结束 */
+		i2c_sim_stuck_count --;
+		i2c_sim_stuck_stat[0] ++;
+		sim->sda_low = 1;
+		sim->scl_release = delay_deadline(i2c_sim_stuck_scl_ms * 1000);
+		sim->stage = I2C_SIM_STAGE_STUCK;
+	}
+	else if((sim->dev == 0) || (sim->speed > sim->dev->speed))
+	{
+		sim->status = sim->dev ? I2C_XFER_BERR : I2C_XFER_NACK;
+		sim->end = delay_deadline(i2c_sim_bits_us(sim->speed, bits + 1));
+		sim->stage = I2C_SIM_STAGE_XFER;
+	}
+	else if(((xfer->flags & (I2C_XFER_REG | I2C_XFER_READ)) == I2C_XFER_REG) && xfer->gap && xfer->count && !xfer->seg_num)
+	{
+		/* 寄存器地址发送后需要间隔 */
+		sim->end = delay_deadline(i2c_sim_bits_us(sim->speed, bits + 9));
+		sim->stage = I2C_SIM_STAGE_REG;
+	}
+	else
+	{
+		i2c_sim_exec(sim, bits);
+	}
+}
+
+/*!
+	\功能       寄存器间隔结束，继续发送数据
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_resume(unsigned char bus)
+{
+	i2c_sim_bus * sim = &i2c_sim_bus_tab[bus];
+
+	if(sim->stage == I2C_SIM_STAGE_GAP)
+	{
+		/* 寄存器地址已计入线上时间 */
+		i2c_sim_exec(sim, 0);
+		sim->end -= i2c_sim_bits_us(sim->speed, 9);
+	}
+}
+
+/*!
+	\功能       关闭中断，模拟总线无需处理
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_stop(unsigned char bus)
+{
+}
+
+/*!
+	\功能       总线恢复，放弃正在进行的传输：9个SCL时钟让拉低SDA的从机送完当前字节并释放SDA，
+	            从机仍拉低SCL时时钟发不出去，总线保持忙；之后软件复位清除时钟配置，
+	            与GD32后端相同，由i2c.c随后调用i2c_hal_speed_set重新配置
+	\参数[输入] bus: 总线序号
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_recover(unsigned char bus)
+{
+	i2c_sim_bus * sim = &i2c_sim_bus_tab[bus];
+
+	sim->xfer = 0;
+	sim->stage = I2C_SIM_STAGE_IDLE;
+	if(sim->sda_low)
+	{
+		i2c_sim_stuck_stat[1] ++;
+		if(delay_expired(sim->scl_release))
+		{
+			sim->sda_low = 0;
+			i2c_sim_stuck_stat[2] ++;
+		}
+	}
+	sim->speed = 0;
+}
+
+/*!
+	\功能       屏蔽模拟中断
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       屏蔽前的状态，交给i2c_hal_irq_restore
+*/
+unsigned int i2c_hal_irq_save(void)
+{
+	unsigned int state = i2c_sim_irq_mask;
+
+	i2c_sim_irq_mask = 1;
+	return state;
+}
+
+/*!
+	\功能       恢复模拟中断的屏蔽状态
+	\参数[输入] state: i2c_hal_irq_save的返回值
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_irq_restore(unsigned int state)
+{
+	i2c_sim_irq_mask = state;
+}
+
+/*!
+	\功能       按键基准测试：按下和松开交替，按下的时刻在平均间隔附近随机分布，与主循环的相位无关
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+static void i2c_sim_key_bench(void)
+{
+	unsigned int half = i2c_sim_key_bench_ms / 2;
+
+	i2c_sim_key_bench_down = !i2c_sim_key_bench_down;
+	if(!i2c_sim_key_bench_down)
+	{
+		i2c_sim_key_set(0);
+		i2c_sim_key_bench_next = delay_time_ms() + half / 2 + rand() % (half + 1);
+	}
+	else
+	{
+		i2c_sim_key_set('#');
+		i2c_sim_key_bench_next = delay_time_ms() + half;
+	}
+}
+
+/*!
+	\功能       推进模拟传输：线上时间到达的阶段在此结束，相当于GD32后端的I2C中断；运行时长到达时退出
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_hal_poll(void)
+{
+	i2c_sim_bus * sim;
+
+	if(i2c_sim_irq_mask)
+	{
+		return;
+	}
+	i2c_sim_irq_mask = 1;
+	for(int i=0; i<sizeof(i2c_sim_bus_tab)/sizeof(i2c_sim_bus); i++)
+	{
+		sim = &i2c_sim_bus_tab[i];
+		if((sim->stage == I2C_SIM_STAGE_IDLE) || (sim->stage == I2C_SIM_STAGE_GAP) ||
+		   (sim->stage == I2C_SIM_STAGE_STUCK) || !delay_expired(sim->end))
+		{
+			continue;
+		}
+		if(sim->stage == I2C_SIM_STAGE_REG)
+		{
+			sim->stage = I2C_SIM_STAGE_GAP;
+			i2c_hal_gap(i);
+		}
+		else
+		{
+			sim->stage = I2C_SIM_STAGE_IDLE;
+			sim->xfer = 0;
+			i2c_hal_done(i, sim->status);
+		}
+	}
+	i2c_sim_irq_mask = 0;
+
+	if(i2c_sim_key_bench_ms && (delay_time_ms() >= i2c_sim_key_bench_next))
+	{
+		i2c_sim_key_bench();
+	}
+	if((i2c_sim_unplug_stage < 2) && (delay_time_ms() >= i2c_sim_unplug_ms[i2c_sim_unplug_stage]))
+	{
+		/* 第0步拔出，第1步接入 */
+		i2c_sim_present_set(i2c_sim_unplug_bus, I2C_SIM_ADDR(i2c_sim_unplug_addr), i2c_sim_unplug_stage);
+		i2c_sim_unplug_stage ++;
+	}
+	if(i2c_sim_run_ms && (delay_time_ms() >= i2c_sim_run_ms))
+	{
+		exit(0);
+	}
+}
+
+/*!
+	\功能       接入或拔出模拟从机，接入时从机上电复位
+	\参数[输入] bus    : 总线序号
+	\参数[输入] addr   : 从机地址
+	\参数[输入] present: 1表示接入，0表示拔出
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_present_set(unsigned char bus, unsigned char addr, int present)
+{
+	i2c_sim_dev * dev = i2c_sim_dev_find(bus, addr);
+
+	if(dev)
+	{
+		if(present && !dev->present)
+		{
+			dev->reset(dev);
+		}
+		dev->present = present;
+	}
+}
+
+/*!
+	\功能       设置总线挂死测试：从机接下来的count次传输在中途拉低SDA，直到i2c_hal_recover
+	\参数[输入] bus   : 总线序号
+	\参数[输入] addr  : 从机地址
+	\参数[输入] count : 挂死的传输次数，0表示取消
+	\参数[输入] scl_ms: 从机同时拉低SCL的时长（毫秒），其间的恢复无效
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_stuck_set(unsigned char bus, unsigned char addr, unsigned int count, unsigned int scl_ms)
+{
+	i2c_sim_stuck_bus = bus;
+	i2c_sim_stuck_addr = addr;
+	i2c_sim_stuck_count = count;
+	i2c_sim_stuck_scl_ms = scl_ms;
+}
+
+/*!
+	\功能       设置按下的键
+	\参数[输入] key: 键值，与s1.h中的SWx相同，SWN表示松开
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_key_set(char key)
+{
+	/* 按s1_key_value_get的排列：键k在按键RAM的第(k%3)*2字节、第k/3位 */
+	const char * keys = "123456789*0#";
+	const char * pos = key ? strchr(keys, key) : 0;
+
+	memset(i2c_sim_keys, 0, sizeof(i2c_sim_keys));
+	if(pos)
+	{
+		i2c_sim_keys[((pos - keys) % 3) * 2] = 1 << ((pos - keys) / 3);
+		i2c_sim_key_time = delay_time_us();
+	}
+}
+
+/*!
+	\功能       获取距最近一次按下的时间，主程序处理按键时调用即得到按键到动作的延迟
+	\参数[输入] 无
+	\参数[输出] 无
+	\返回       时间（微秒）
+*/
+unsigned int i2c_sim_key_age_us(void)
+{
+	return delay_elapsed_us(i2c_sim_key_time);
+}
+
+/*!
+	\功能       把卡片放到NFC天线上或拿开
+	\参数[输入] uid: 4字节卡号，为NULL时拿开卡片
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_card_set(const unsigned char * uid)
+{
+	i2c_sim_card_present = (uid != 0);
+	i2c_sim_card_halted = 0;
+	i2c_sim_card_auth = 0;
+	i2c_sim_card_write_block = -1;
+	if(uid)
+	{
+		memcpy(i2c_sim_card_uid, uid, 4);
+		memcpy(i2c_sim_card_mem[0], uid, 4);
+		i2c_sim_card_mem[0][4] = uid[0] ^ uid[1] ^ uid[2] ^ uid[3];
+	}
+}
+
+/*!
+	\功能       设置光照强度
+	\参数[输入] lux: 光照强度（lx）
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_light_set(unsigned int lux)
+{
+	i2c_sim_lux = lux;
+}
+
+/*!
+	\功能       设置温湿度
+	\参数[输入] temp: 温度（℃）
+	\参数[输入] humi: 湿度（%RH）
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_ths_set(float temp, float humi)
+{
+	i2c_sim_temp = temp;
+	i2c_sim_humi = humi;
+}
+
+/*!
+	\功能       设置加速度
+	\参数[输入] x: X轴加速度（mg）
+	\参数[输入] y: Y轴加速度（mg）
+	\参数[输入] z: Z轴加速度（mg）
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_accel_set(short x, short y, short z)
+{
+	i2c_sim_accel[0] = x;
+	i2c_sim_accel[1] = y;
+	i2c_sim_accel[2] = z;
+}
+
+/*!
+	\功能       设置人体红外状态
+	\参数[输入] status: 1表示有人，0表示无人
+	\参数[输出] 无
+	\返回       无
+*/
+void i2c_sim_ir_set(unsigned char status)
+{
+	i2c_sim_ir = status;
+}
+
+/*!
+	\功能       读取模拟从机的寄存器，不经过总线，用于检查驱动的输出（如数码管显示RAM、PWM寄存器）
+	\参数[输入] bus  : 总线序号
+	\参数[输入] addr : 从机地址
+	\参数[输入] reg  : 寄存器的地址
+	\参数[输入] count: 寄存器个数
+	\参数[输出] pbytes: 寄存器的值
+	\返回       1表示成功，0表示从机不存在
+*/
+int i2c_sim_ram_get(unsigned char bus, unsigned char addr, unsigned char reg, unsigned char * pbytes, unsigned char count)
+{
+	i2c_sim_dev * dev = i2c_sim_dev_find(bus, addr);
+
+	if(dev == 0)
+	{
+		return 0;
+	}
+	for(int i=0; i<count; i++)
+	{
+		pbytes[i] = dev->regs[(reg + i) & 0xFF];
+	}
+	return 1;
+}
+#endif /* BSP_HAL_SIM */
@@ -1,44 +1,15 @@
 #include "s1.h"
 
-i2c_slave_info s1_key_info;
+i2c_slave_info * s1_key_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char S1_HT16K33_ADDR[] = {0xE8, 0xEA, 0xEC, 0xEE};
-#else
-const static unsigned char S1_HT16K33_ADDR[] = {0x74, 0x75, 0x76, 0x77};
-#endif
+/* 后台按键扫描：按S1_KEY_SCAN_US的周期读取按键RAM，新按下的键暂存到被取走为止 */
+static i2c_periodic s1_key_scan;
+static unsigned char s1_key_ram[6];
+static volatile char s1_key_level = SWN;   /* 最近一次扫描的键值 */
+static volatile char s1_key_pressed = SWN; /* 尚未取走的新按下的键 */
 
-static void s1_ht16k33_init(i2c_slave_info info)
+static char s1_key_decode(const unsigned char * buf)
 {
-	i2c_byte_write(info, 0x21);
-}
-
-i2c_slave_info s1_key_init(void)
-{
-	i2c_slave_info info;
-
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
-	{
-		for(int j=0; j<sizeof(S1_HT16K33_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], S1_HT16K33_ADDR[j]);
-			if(info.flag)
-			{
-				s1_ht16k33_init(info);
-				return info;
-			}
-		}
-	}
-	return info;
-}
-
-char s1_key_value_get(i2c_slave_info info)
-{
-	unsigned char buf[6] = {0};
-
-	i2c_reg_bytes_read(info, 0x40, buf, sizeof(buf));
-
 	if(buf[0] & 0x01)
 	{
 		return SW1;
@@ -92,3 +63,58 @@ char s1_key_value_get(i2c_slave_info info)
 		return SWN;
 	}
 }
+
+static void s1_key_scan_done(i2c_periodic * periodic)
+{
+	char key = (periodic->xfer.status == I2C_XFER_DONE) ? s1_key_decode(s1_key_ram) : SWN;
+
+	if((key != SWN) && (key != s1_key_level))
+	{
+		/* 新按键：让NFC等长序列让出，主循环尽快处理 */
+		s1_key_pressed = key;
+		i2c_yield_request(I2C_PRIO_INPUT);
+	}
+	s1_key_level = key;
+}
+
+static void s1_ht16k33_init(i2c_slave_info * info)
+{
+	i2c_byte_write(info, 0x21);
+
+	i2c_xfer_init(&s1_key_scan.xfer, info, I2C_XFER_REG | I2C_XFER_READ, 0x40, s1_key_ram, sizeof(s1_key_ram));
+	s1_key_scan.callback = s1_key_scan_done;
+	i2c_periodic_start(&s1_key_scan, S1_KEY_SCAN_US);
+}
+
+i2c_slave_info * s1_key_init(void)
+{
+	i2c_slave_info * info;
+
+	info = i2c_dev_lookup(I2C_DEV_S1_KEY);
+	if(info->flag)
+	{
+		s1_ht16k33_init(info);
+	}
+	return info;
+}
+
+char s1_key_value_get(i2c_slave_info * info)
+{
+	char key;
+
+	if(!info->flag)
+	{
+		return SWN;
+	}
+	/* 总线上没有其他传输时由这里推进后台扫描 */
+	i2c_xfer_poll();
+	key = s1_key_pressed;
+	if(key != SWN)
+	{
+		/* 先返回扫描期间按下的键，两次调用之间按下又松开的键也不会丢失 */
+		s1_key_pressed = SWN;
+		i2c_yield_clear(I2C_PRIO_INPUT);
+		return key;
+	}
+	return s1_key_level;
+}
@@ -1,81 +1,53 @@
 #include "s2.h"
 
-i2c_slave_info s2_illuminance_info;
+i2c_slave_info * s2_illuminance_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char S2_BH1750_ADDR[] = {0x46, 0xB8};
-#else
-const static unsigned char S2_BH1750_ADDR[] = {0x23, 0x5C};
-#endif
-
-static void s2_bh1750_init(i2c_slave_info info)
+static void s2_bh1750_init(i2c_slave_info * info)
 {
 	i2c_byte_write(info, 0x01);
 }
 
-i2c_slave_info s2_illuminance_init(void)
+i2c_slave_info * s2_illuminance_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_S2_LIGHT);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(S2_BH1750_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], S2_BH1750_ADDR[j]);
-			if(info.flag)
-			{
-				s2_bh1750_init(info);
-				return info;
-			}
-		}
+		s2_bh1750_init(info);
 	}
 	return info;
 }
 
-unsigned int s2_illuminance_value_get(i2c_slave_info info)
+unsigned int s2_illuminance_value_get(i2c_slave_info * info)
 {
 	unsigned char buf[2];
 	unsigned int illuminance = 0;
 
 	i2c_byte_write(info, 0x01);
 	i2c_byte_write(info, 0x10);
-	i2c_delay_ms(10);
+	delay_ms(10);
 	i2c_bytes_read(info, buf, 2);
 	illuminance = (buf[0]<<8) + buf[1];
 
 	return illuminance;
 }
 
-i2c_slave_info s2_ths_info;
-
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char S2_SHT3X_ADDR[] = {0x88, 0x8A};
-#else
-const static unsigned char S2_SHT3X_ADDR[] = {0x44, 0x45};
-#endif
+i2c_slave_info * s2_ths_info;
 
-static void s2_sht3x_init(i2c_slave_info info)
+static void s2_sht3x_init(i2c_slave_info * info)
 {
 	i2c_reg_byte_write(info, 0x30, 0xA2);
 }
 
-i2c_slave_info s2_ths_init(void)
+i2c_slave_info * s2_ths_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_THS);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(S2_SHT3X_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], S2_SHT3X_ADDR[j]);
-			if(info.flag)
-			{
-				s2_sht3x_init(info);
-				return info;
-			}
-		}
+		s2_sht3x_init(info);
 	}
 	return info;
 }
@@ -109,14 +81,14 @@ static unsigned char s2_sht3x_crc_cal(unsigned short data)
 	return crc_byte;
 }
 
-s2_ths_t s2_ths_value_get(i2c_slave_info info)
+s2_ths_t s2_ths_value_get(i2c_slave_info * info)
 {
 	s2_ths_t ths_value;
 	unsigned char buf[6];
 	unsigned short tmp;
 
 	i2c_reg_byte_write(info, 0x2C, 0x0D);
-	i2c_delay_ms(10);
+	delay_ms(10);
 	i2c_bytes_read(info, buf, 6);
 
 	tmp = (buf[0]<<8) + buf[1];
@@ -134,57 +106,66 @@ s2_ths_t s2_ths_value_get(i2c_slave_info info)
 	return ths_value;
 }
 
-i2c_slave_info s2_imu_info;
+i2c_slave_info * s2_imu_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char S2_ICM20608_ADDR[] = {0xD0, 0xD2};
-#else
-const static unsigned char S2_ICM20608_ADDR[] = {0x68, 0x69};
-#endif
+/* ICM20608配置：0x19~0x1E（采样率、低通滤波、陀螺仪和加速度量程、低功耗）地址连续，一段写入；
+   FIFO使能（0x23）和电源管理2（0x6C）各一段 */
+static unsigned char s2_icm20608_config[] = {0x00, 0x04, 0x18, 0x18, 0x04, 0x00};
+static unsigned char s2_icm20608_zero = 0x00;
+static const i2c_seg s2_icm20608_segs[] =
+{
+	{0x19, s2_icm20608_config, sizeof(s2_icm20608_config)},
+	{0x23, &s2_icm20608_zero, 1},
+	{0x6C, &s2_icm20608_zero, 1},
+};
 
-static void s2_icm20608_init(i2c_slave_info info)
+static void s2_icm20608_init(i2c_slave_info * info)
 {
 	i2c_reg_byte_write(info, 0x6B, 0x80);
-	i2c_delay_ms(10);
+	delay_ms(10);
 	i2c_reg_byte_write(info, 0x6B, 0x01);
-	i2c_delay_ms(10);
-	i2c_reg_byte_write(info, 0x19, 0x00);
-	i2c_reg_byte_write(info, 0x1B, 0x18);
-	i2c_reg_byte_write(info, 0x1C, 0x18);
-	i2c_reg_byte_write(info, 0x1A, 0x04);
-	i2c_reg_byte_write(info, 0x1D, 0x04);
-	i2c_reg_byte_write(info, 0x6C, 0x00);
-	i2c_reg_byte_write(info, 0x1E, 0x00);
-	i2c_reg_byte_write(info, 0x23, 0x00);
+	delay_ms(10);
+	i2c_reg_segs_write(info, s2_icm20608_segs, sizeof(s2_icm20608_segs)/sizeof(i2c_seg));
 }
 
-i2c_slave_info s2_imu_init(void)
+i2c_slave_info * s2_imu_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_S2_IMU);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(S2_ICM20608_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], S2_ICM20608_ADDR[j]);
-			if(info.flag)
-			{
-				s2_icm20608_init(info);
-				return info;
-			}
-		}
+		s2_icm20608_init(info);
 	}
 	return info;
 }
 
-s2_imu_t s2_imu_value_get(i2c_slave_info info)
+/* 加速度、温度和角速度寄存器（0x3B~0x48）的预取 */
+static i2c_prefetch s2_imu_prefetch;
+static unsigned char s2_imu_prefetch_buf[14];
+
+void s2_imu_value_prefetch(i2c_slave_info * info)
+{
+	i2c_prefetch_start(&s2_imu_prefetch, info, 0x3B, s2_imu_prefetch_buf, sizeof(s2_imu_prefetch_buf));
+}
+
+s2_imu_t s2_imu_value_get(i2c_slave_info * info)
 {
 	s2_imu_t imu_value;
 	unsigned char buf[14] = {0};
 	short acc_x, acc_y, acc_z, gyr_x, gyr_y, gyr_z, temp;
 
-	i2c_reg_bytes_read(info, 0x3B, buf, 14);
+	if(i2c_prefetch_take(&s2_imu_prefetch))
+	{
+		for(int i=0; i<sizeof(buf); i++)
+		{
+			buf[i] = s2_imu_prefetch_buf[i];
+		}
+	}
+	else
+	{
+		i2c_reg_bytes_read(info, 0x3B, buf, 14);
+	}
 
 	acc_x = (buf[0]  << 8) | buf[1]; 
 	acc_y = (buf[2]  << 8) | buf[3]; 
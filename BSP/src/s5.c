@@ -1,12 +1,10 @@
 #include "s5.h"
 
-i2c_slave_info s5_nfc_info;
+i2c_slave_info * s5_nfc_info;
 
-#if defined (GD32F450) || defined (GD32F470)
-const static unsigned char S5_MS523_ADDR[] = {0x50, 0x52, 0x54, 0x56};
-#else
-const static unsigned char S5_MS523_ADDR[] = {0x28, 0x29, 0x2a, 0x2b};
-#endif
+/* shadow caches for the configuration registers, which only change when written by the MCU */
+static i2c_shadow s5_ms523_shadow_tx;    /* ModeReg ~ SerialSpeedReg */
+static i2c_shadow s5_ms523_shadow_timer; /* ModWidthReg ~ TReloadRegL */
 
 /*!
 	\brief      clear register bit
@@ -15,7 +13,7 @@ const static unsigned char S5_MS523_ADDR[] = {0x28, 0x29, 0x2a, 0x2b};
 	\param[out] none
 	\retval     none
 */
-static void s5_ms523_bit_clear(i2c_slave_info info, unsigned char reg, unsigned char mask)
+static void s5_ms523_bit_clear(i2c_slave_info * info, unsigned char reg, unsigned char mask)
 {
 	unsigned char temp = 0x00;
 
@@ -30,7 +28,7 @@ static void s5_ms523_bit_clear(i2c_slave_info info, unsigned char reg, unsigned
 	\param[out] none
 	\retval     none
 */
-static void s5_ms523_bit_set(i2c_slave_info info, unsigned char reg, unsigned char mask)
+static void s5_ms523_bit_set(i2c_slave_info * info, unsigned char reg, unsigned char mask)
 {
 	unsigned char temp = 0x00;
 
@@ -44,7 +42,7 @@ static void s5_ms523_bit_set(i2c_slave_info info, unsigned char reg, unsigned ch
 	\param[out] none
 	\retval     none
 */
-static void s5_ms523_antenna_on(i2c_slave_info info)
+static void s5_ms523_antenna_on(i2c_slave_info * info)
 {
 	unsigned char i;
 
@@ -62,28 +60,36 @@ static void s5_ms523_antenna_on(i2c_slave_info info)
 	\param[out] none
 	\retval     none
 */
-static void s5_ms523_antenna_off(i2c_slave_info info)
+static void s5_ms523_antenna_off(i2c_slave_info * info)
 {
 	s5_ms523_bit_clear(info, TxControlReg, 0x03);
 }
 
+/* register setup after a soft reset, written as one vectored transfer */
+static unsigned char s5_ms523_reset_value[] = {0x3D, 30, 0, 0x8D, 0x3E, 0x40};
+static const i2c_seg s5_ms523_reset_segs[] =
+{
+	{ModeReg,       &s5_ms523_reset_value[0], 1},
+	{TReloadRegL,   &s5_ms523_reset_value[1], 1},
+	{TReloadRegH,   &s5_ms523_reset_value[2], 1},
+	{TModeReg,      &s5_ms523_reset_value[3], 1},
+	{TPrescalerReg, &s5_ms523_reset_value[4], 1},
+	{TxAutoReg,     &s5_ms523_reset_value[5], 1},
+};
+
 /*!
 	\brief      reset MS523
 	\param[in]  none
 	\param[out] none
 	\retval     none
 */
-static void s5_ms523_reset(i2c_slave_info info)
+static void s5_ms523_reset(i2c_slave_info * info)
 {
 	i2c_reg_byte_write(info, CommandReg, PCD_RESETPHASE);
-	i2c_delay_ms(10);
+	delay_ms(10);
+	i2c_shadow_invalidate(info);
 
-	i2c_reg_byte_write(info, ModeReg, 0x3D);
-	i2c_reg_byte_write(info, TReloadRegL, 30);
-	i2c_reg_byte_write(info, TReloadRegH, 0);
-	i2c_reg_byte_write(info, TModeReg, 0x8D);
-	i2c_reg_byte_write(info, TPrescalerReg, 0x3E);
-	i2c_reg_byte_write(info, TxAutoReg, 0x40);
+	i2c_reg_segs_write(info, s5_ms523_reset_segs, sizeof(s5_ms523_reset_segs)/sizeof(i2c_seg));
 	s5_ms523_bit_clear(info, TestPinEnReg, 0x80);
 	i2c_reg_byte_write(info, TxAutoReg, 0x40);
 }
@@ -95,10 +101,10 @@ static void s5_ms523_reset(i2c_slave_info info)
 	\param[in]  InLenByte:Send data length
 	\param[out] pOutData:receive data
 	\param[out] pOutLenBit:receive data bit lenth
-	\retval     Communication status
+	\retval     Communication status, MI_YIELD when a higher priority input preempted it
 */
 #define MAXRLEN		18
-static char s5_ms523_comm(i2c_slave_info info, unsigned char Command, unsigned char *pInData, unsigned char InLenByte, unsigned char *pOutData, unsigned short  *pOutLenBit)
+static char s5_ms523_comm(i2c_slave_info * info, unsigned char Command, unsigned char *pInData, unsigned char InLenByte, unsigned char *pOutData, unsigned short  *pOutLenBit)
 {
 	char status = MI_ERR;
 	unsigned char irqEn = 0x00;
@@ -106,6 +112,7 @@ static char s5_ms523_comm(i2c_slave_info info, unsigned char Command, unsigned c
 	unsigned char lastBits;
 	unsigned char n;
 	unsigned short i;
+	unsigned int start;
 
 	switch(Command)
 	{
@@ -134,8 +141,17 @@ static char s5_ms523_comm(i2c_slave_info info, unsigned char Command, unsigned c
 	}
 
 	i = 1000;
+	start = delay_time_us();
 	do
 	{
+		/* a higher priority input is waiting: after at least one poll and the short-frame answer window,
+		   give up with MI_YIELD, the caller retries on its next pass */
+		if (i2c_yield_check(info->prio) && (i != 1000) && (delay_elapsed_us(start) >= S5_NFC_YIELD_MIN_US))
+		{
+			status = MI_YIELD;
+			i = 0;
+			break;
+		}
 		i2c_reg_bytes_read(info, ComIrqReg, &n, 1);
 		i--;
 	}while ((i != 0) && !(n & 0x01) && !(n & waitFor));
@@ -195,7 +211,7 @@ static char s5_ms523_comm(i2c_slave_info info, unsigned char Command, unsigned c
 	\param[out] pOutData:receive data
 	\retval     none
 */
-static void s5_ms523_crc_calc(i2c_slave_info info, unsigned char *pIndata, unsigned char len, unsigned char *pOutData)
+static void s5_ms523_crc_calc(i2c_slave_info * info, unsigned char *pIndata, unsigned char len, unsigned char *pOutData)
 {
 	unsigned char i, n;
 
@@ -223,7 +239,7 @@ static void s5_ms523_crc_calc(i2c_slave_info info, unsigned char *pIndata, unsig
 	\param[out] none
 	\retval     status
 */
-static char s5_ms523_type_config(i2c_slave_info info, unsigned char type)
+static char s5_ms523_type_config(i2c_slave_info * info, unsigned char type)
 {
 	if('A' == type)
 	{
@@ -235,7 +251,7 @@ static char s5_ms523_type_config(i2c_slave_info info, unsigned char type)
 		i2c_reg_byte_write(info, TReloadRegH, 0);
 		i2c_reg_byte_write(info, TModeReg, 0x8D);
 		i2c_reg_byte_write(info, TPrescalerReg, 0x3E);
-		i2c_delay_ms(10);
+		delay_ms(10);
 		s5_ms523_antenna_on(info);
 	}
 	else
@@ -246,31 +262,25 @@ static char s5_ms523_type_config(i2c_slave_info info, unsigned char type)
 	return MI_OK;
 }
 
-static void s5_ms523_init(i2c_slave_info info)
+static void s5_ms523_init(i2c_slave_info * info)
 {
+	i2c_shadow_attach(&s5_ms523_shadow_tx, info, ModeReg, SerialSpeedReg - ModeReg + 1);
+	i2c_shadow_attach(&s5_ms523_shadow_timer, info, ModWidthReg, TReloadRegL - ModWidthReg + 1);
 	s5_ms523_reset(info);
 	s5_ms523_antenna_off(info);
-	i2c_delay_ms(10);
+	delay_ms(10);
 	s5_ms523_antenna_on(info);
 	s5_ms523_type_config(info, 'A');
 }
 
-i2c_slave_info s5_nfc_init(void)
+i2c_slave_info * s5_nfc_init(void)
 {
-	i2c_slave_info info;
+	i2c_slave_info * info;
 
-	i2c_init();
-	for(int i=0; i<sizeof(I2C_PERIPH_NUM)/sizeof(unsigned int); i++)
+	info = i2c_dev_lookup(I2C_DEV_S5_NFC);
+	if(info->flag)
 	{
-		for(int j=0; j<sizeof(S5_MS523_ADDR)/sizeof(unsigned char); j++)
-		{
-			info = i2c_slave_detect(I2C_PERIPH_NUM[i], S5_MS523_ADDR[j]);
-			if(info.flag)
-			{
-				s5_ms523_init(info);
-				return info;
-			}
-		}
+		s5_ms523_init(info);
 	}
 	return info;
 }
@@ -287,7 +297,7 @@ i2c_slave_info s5_nfc_init(void)
 	\param[out]	none
 	\retval			status
 */
-char s5_nfc_request(i2c_slave_info info, unsigned char RequestType, unsigned char *pCardType)
+char s5_nfc_request(i2c_slave_info * info, unsigned char RequestType, unsigned char *pCardType)
 {
 	char status;
 	unsigned short unLen;
@@ -304,7 +314,7 @@ char s5_nfc_request(i2c_slave_info info, unsigned char RequestType, unsigned cha
 		*pCardType = ucComMS523Buf[0];
 		*(pCardType + 1) = ucComMS523Buf[1];
 	}
-	else
+	else if (status != MI_YIELD)
 	{
 		status = MI_ERR;
 	}
@@ -318,7 +328,7 @@ char s5_nfc_request(i2c_slave_info info, unsigned char RequestType, unsigned cha
 	\param[in]	none
 	\retval			status
 */
-char s5_nfc_anticoll(i2c_slave_info info, unsigned char *pCardID)
+char s5_nfc_anticoll(i2c_slave_info * info, unsigned char *pCardID)
 {
 	char status;
 	unsigned char i, snr_check = 0;
@@ -356,7 +366,7 @@ char s5_nfc_anticoll(i2c_slave_info info, unsigned char *pCardID)
 	\param[out] none
 	\retval     status
 */
-char s5_nfc_select(i2c_slave_info info, unsigned char *pCardID)
+char s5_nfc_select(i2c_slave_info * info, unsigned char *pCardID)
 {
 	char status;
 	unsigned char i;
@@ -379,7 +389,7 @@ char s5_nfc_select(i2c_slave_info info, unsigned char *pCardID)
 	{
 		status = MI_OK;
 	}
-	else
+	else if (status != MI_YIELD)
 	{
 		status = MI_ERR;
 	}
@@ -396,7 +406,7 @@ char s5_nfc_select(i2c_slave_info info, unsigned char *pCardID)
 	\param[out] none
 	\retval     status
 */
-char s5_nfc_auth(i2c_slave_info info, unsigned char AuthMode, unsigned char addr, unsigned char *pKey, unsigned char *pCardID)
+char s5_nfc_auth(i2c_slave_info * info, unsigned char AuthMode, unsigned char addr, unsigned char *pKey, unsigned char *pCardID)
 {
 	char status;
 	unsigned short unLen;
@@ -415,7 +425,7 @@ char s5_nfc_auth(i2c_slave_info info, unsigned char AuthMode, unsigned char addr
 	}
 	status = s5_ms523_comm(info, PCD_AUTHENT, ucComMS523Buf, 12, ucComMS523Buf, &unLen);
 	i2c_reg_bytes_read(info, Status2Reg, &temp, 1);
-	if((status != MI_OK) || (!(temp & 0x08)))
+	if((status != MI_YIELD) && ((status != MI_OK) || (!(temp & 0x08))))
 	{   
 		status = MI_ERR;   
 	}
@@ -429,7 +439,7 @@ char s5_nfc_auth(i2c_slave_info info, unsigned char AuthMode, unsigned char addr
 	\param[out] pData: data
 	\retval     status
 */
-char s5_nfc_read(i2c_slave_info info, unsigned char addr, unsigned char *pData)
+char s5_nfc_read(i2c_slave_info * info, unsigned char addr, unsigned char *pData)
 {
 	char status;
 	unsigned short unLen;
@@ -446,7 +456,7 @@ char s5_nfc_read(i2c_slave_info info, unsigned char addr, unsigned char *pData)
 			*(pData+i) = ucComMS523Buf[i];   
 		}
 	}
-	else
+	else if (status != MI_YIELD)
 	{
 		status = MI_ERR;   
 	}
@@ -460,7 +470,7 @@ char s5_nfc_read(i2c_slave_info info, unsigned char addr, unsigned char *pData)
 	\param[in] 	pData: data
 	\retval     status
 */                
-char s5_nfc_write(i2c_slave_info info, unsigned char addr, unsigned char *pData)
+char s5_nfc_write(i2c_slave_info * info, unsigned char addr, unsigned char *pData)
 {
 	char status;
 	unsigned short unLen;
@@ -470,7 +480,7 @@ char s5_nfc_write(i2c_slave_info info, unsigned char addr, unsigned char *pData)
 	ucComMS523Buf[1] = addr;
 	s5_ms523_crc_calc(info, ucComMS523Buf, 2, &ucComMS523Buf[2]);
 	status = s5_ms523_comm(info, PCD_TRANSCEIVE, ucComMS523Buf, 4, ucComMS523Buf, &unLen);
-	if ((status != MI_OK) || (unLen != 4) || ((ucComMS523Buf[0] & 0x0F) != 0x0A))
+	if ((status != MI_YIELD) && ((status != MI_OK) || (unLen != 4) || ((ucComMS523Buf[0] & 0x0F) != 0x0A)))
 	{
 		status = MI_ERR;   
 	}
@@ -482,7 +492,7 @@ char s5_nfc_write(i2c_slave_info info, unsigned char addr, unsigned char *pData)
 		}
 		s5_ms523_crc_calc(info, ucComMS523Buf, 16, &ucComMS523Buf[16]);
 		status = s5_ms523_comm(info,PCD_TRANSCEIVE, ucComMS523Buf, 18, ucComMS523Buf, &unLen);
-		if ((status != MI_OK) || (unLen != 4) || ((ucComMS523Buf[0] & 0x0F) != 0x0A))
+		if ((status != MI_YIELD) && ((status != MI_OK) || (unLen != 4) || ((ucComMS523Buf[0] & 0x0F) != 0x0A)))
 		{
 			status = MI_ERR;
 		}
@@ -497,7 +507,7 @@ char s5_nfc_write(i2c_slave_info info, unsigned char addr, unsigned char *pData)
 	\param[out] none
 	\retval     status
 */
-char s5_nfc_halt(i2c_slave_info info)
+char s5_nfc_halt(i2c_slave_info * info)
 {
 	unsigned short unLen;
 	unsigned char ucComMS523Buf[MAXRLEN]; 
@@ -1,16 +1,7 @@
 #include "u1.h"
-
-/*!
-	\功能       延时
-	\参数[输入] ms: 延时时间（毫秒）
-	\参数[输出] 无
-	\返回       无
-*/
-void u1_delay_ms(unsigned int ms)
-{
-	for(unsigned int i=0;i<ms;i++)
-		for(unsigned int j=0;j<40000;j++);
-}
+#ifdef BSP_HAL_SIM
+#include <stdio.h>
+#endif
 
 /*!
 	\功能       U1子板LED(RUN)初始化
@@ -110,6 +101,7 @@ void u1_led_toggle(void)
 */
 void u1_timer0_init(void)
 {
+#ifndef BSP_HAL_SIM
 	/* 定义一个用于描述Timer0的结构体变量timer_init_struct */
 	timer_parameter_struct timer_init_struct;
 
@@ -139,6 +131,7 @@ void u1_timer0_init(void)
 	timer_interrupt_enable(TIMER0, TIMER_INT_UP);
 	/* 在NVIC中使能Timer0中断，即Timer0发送的中断信号NVIC会转发给CPU，Timer0的中断优先级为1，中断子优先级为1 */
 	nvic_irq_enable(TIMER0_UP_TIMER9_IRQn, 1, 1); 
+#endif
 }
 
 /*!
@@ -158,3 +151,55 @@ void u1_timer0_init(void)
 //		timer_interrupt_flag_clear(TIMER0, TIMER_INT_FLAG_UP);
 //	}
 //}
+
+/*!
+	\功能       串口(USART0)初始化，TX为PA9，RX为PA10，8位数据，1位停止位，无校验
+	\参数[输入] baudrate: 波特率
+	\参数[输出] 无
+	\返回       无
+*/
+void u1_uart_init(unsigned int baudrate)
+{
+#ifndef BSP_HAL_SIM
+	/* 使能GPIOA组引脚和USART0的时钟 */
+	rcu_periph_clock_enable(RCU_GPIOA);
+	rcu_periph_clock_enable(RCU_USART0);
+
+	/* 设置GPIOA_9和GPIOA_10引脚为USART0的TX和RX功能 */
+	gpio_af_set(GPIOA, GPIO_AF_7, GPIO_PIN_9 | GPIO_PIN_10);
+	/* 设置GPIOA_9和GPIOA_10引脚为复用功能模式，内部上拉 */
+	gpio_mode_set(GPIOA, GPIO_MODE_AF, GPIO_PUPD_PULLUP, GPIO_PIN_9 | GPIO_PIN_10);
+	/* 设置GPIOA_9和GPIOA_10引脚为推挽输出模式，最高输出速度为50MHZ */
+	gpio_output_options_set(GPIOA, GPIO_OTYPE_PP, GPIO_OSPEED_50MHZ, GPIO_PIN_9 | GPIO_PIN_10);
+
+	/* 复位USART0，设置波特率，使能发送和接收 */
+	usart_deinit(USART0);
+	usart_baudrate_set(USART0, baudrate);
+	usart_transmit_config(USART0, USART_TRANSMIT_ENABLE);
+	usart_receive_config(USART0, USART_RECEIVE_ENABLE);
+	usart_enable(USART0);
+#endif
+}
+
+/*!
+	\功能       串口(USART0)发送字符串，等待发送完成
+	\参数[输入] str: 以'\0'结尾的字符串
+	\参数[输出] 无
+	\返回       无
+*/
+void u1_uart_str_send(const char * str)
+{
+#ifdef BSP_HAL_SIM
+	/* PC上输出到标准输出 */
+	fputs(str, stdout);
+#else
+	while(*str)
+	{
+		/* 等待发送缓冲区空 */
+		while(RESET == usart_flag_get(USART0, USART_FLAG_TBE));
+		usart_data_transmit(USART0, *str++);
+	}
+	/* 等待最后一个字节发送完成 */
+	while(RESET == usart_flag_get(USART0, USART_FLAG_TC));
+#endif
+}